@@ -9,6 +9,10 @@
 #include <poll.h>
 #include <bitset>
 #include <random>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <deque>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -21,9 +25,23 @@
 #include "Protocol.hpp"
 #include "ConfReader.hpp"
 #include "Logger.hpp"
+#include "Generator.hpp"
+#include "FragmentCodec.hpp"
+#include "Crc32c.hpp"
+#include "Bundle.hpp"
 
 constexpr int PORT = 8888;
 constexpr int BUFFER_SIZE = 2048;
+constexpr int RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// How hard a transfer tries to get every fragment. BOUNDED asks for resends
+// until the deadline, BEST_EFFORT never does; both keep what arrived by then
+// and write a gap map of the rest
+enum class Reliability : uint8_t {
+    FULL = 0,
+    BOUNDED = 1,
+    BEST_EFFORT = 2
+};
 
 class Client {
 public:
@@ -35,9 +53,36 @@ public:
     bool PrepareDataToSend(const T& header, const MessageType& type);
     bool RequestMissingPackets(const uint32_t& retries);
     bool HandleError(const ErrorHeader& error);
+    bool RebuildFromSeed(const SeedResponseHeader& header);
+    bool RunQuery();
+    bool WriteQueryResult(const char* data, const uint32_t& size);
+    bool RunSubscription();
+    bool DrainStream(const int& ms);
+    void WriteStreamGaps(const std::vector<std::pair<uint32_t, uint32_t>>& gaps);
+    uint32_t Capabilities();
+    bool CheckFragment(const char* datagram, const uint32_t& size, const ProtocolHeader& header, uint32_t& payload_size);
+    uint32_t StoreFragment(const ProtocolHeader& header, const char* payload, const uint32_t& size);
+    bool VerifyDigest();
+    void WriteReceived();
+    void WriteValues(const size_t& end);
 
+    bool SendRequest(const RequestHeader& header);
+    bool PrepareBatchRequest(const RequestHeader& header);
+    void RecordFragmentValues(const ProtocolHeader& header, const uint32_t& values);
+    void CompactBatch();
+    void WriteBatch();
+    void DropMissing();
+    void WriteGaps(const std::vector<uint16_t>& missed_packets);
+    bool PastDeadline();
+    int PollTimeout();
     bool PrepareMissingPackets(const std::vector<uint16_t>& missing_packets, const uint32_t id);
+    bool ReportMissing(const std::vector<uint16_t>& missed_packets);
+    uint32_t ReceiveWindow(const uint32_t& packet_size);
+    void AdvanceWindow(const uint16_t& packet_number, const bool& duplicate);
+    bool SendCumulativeAck();
     bool SendMessage(char* buffer, const uint32_t& buffer_size);
+    bool Poll(const int& timeout_ms);
+    int Receive();
     ~Client();
 private:
     uint32_t client_id;
@@ -48,13 +93,38 @@ private:
     #else
     int sockfd;
     #endif
-    char buffer[BUFFER_SIZE];
+    // Room for the largest packet a session can agree on
+    char buffer[MAX_NEGOTIATED_PACKET_SIZE + MAX_TRAILER_SIZE];
+    // Messages of a received BUNDLE not handed out by Receive yet
+    std::deque<std::vector<char>> bundled;
     int packet_num;
     std::vector<double> arr;
     struct pollfd pollStruct[1];
     std::vector<bool> packets_received;
     uint32_t len;
     uint32_t counter;
+    uint32_t written_packets;
+    uint32_t values_per_packet;
+    // Batches: fragments per sub-stream, and the values each one turned out
+    // to hold
+    uint32_t part_packets;
+    std::vector<uint32_t> part_values;
+    // Agreed at CONNECT
+    uint32_t capabilities;
+    uint32_t packet_data_size;
+    // Flow control: fragments the client takes beyond received_through, which
+    // every fragment up to has arrived, and what the server was last told
+    uint32_t receive_window;
+    uint32_t received_through;
+    uint32_t advertised_through;
+    uint32_t highest_received;
+    ValuePrecision response_precision;
+    Reliability reliability;
+    std::chrono::system_clock::time_point deadline;
+    bool digest_received;
+    uint32_t digest;
+    size_t written_values;
+    std::ofstream fout;
     Logger logger;
     ServerConfig conf;
     ConfReader reader;
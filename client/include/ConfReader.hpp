@@ -2,14 +2,34 @@
 #define CONF_READER_HPP
 
 #include <fstream>
+#include <vector>
 #include "json.hpp"
 
 struct ServerConfig {
     ServerConfig() {}
-    ServerConfig(const int& port, const std::string& ip, const double& val);
+    ServerConfig(const int& port, const std::string& ip, const double& val, const bool& seed, const bool& sort,
+                 const std::string& query_kind, const uint32_t& query_param, const bool& compress,
+                 const std::string& value_precision, const bool& fragment_checksums,
+                 const uint32_t& packet_size, const std::vector<double>& batch,
+                 const std::string& reliability_level, const uint32_t& deadline,
+                 const uint32_t& rate, const uint32_t& seconds);
     int server_port;
     std::string server_ip;
     double value;
+    bool seed_only;
+    bool server_sort;
+    std::string query;
+    uint32_t query_parameter;
+    bool compressed;
+    std::string precision;
+    bool checksums;
+    uint32_t max_packet_size;
+    std::vector<double> batch_values;
+    std::string reliability;
+    uint32_t deadline_ms;
+    // Values per second asked of a subscription, 0 for a one-off request
+    uint32_t subscribe_rate;
+    uint32_t subscribe_seconds;
 };
 
 class ConfReader {
@@ -0,0 +1,30 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), as used by iSCSI and ext4: reflected polynomial
+// 0x82F63B78, initial value and final xor 0xFFFFFFFF.
+// CPUs with SSE4.2 use the crc32 instruction on three interleaved lanes,
+// which hides its latency, and merge the lanes with a table that multiplies
+// a CRC by x^(8 * LANE_SIZE). Others fall back to slicing-by-8 tables. Both
+// give the same result; the kernel is picked once at startup.
+class Crc32c {
+public:
+    // Interleaved lanes are used for inputs of at least 3 * LANE_SIZE bytes,
+    // which a full RESPONSE fragment is
+    static constexpr size_t LANE_SIZE = 512;
+
+    static uint32_t Compute(const void* data, const size_t& size);
+    // CRC of the data that gave `crc` followed by `data`, so a digest can be
+    // built chunk by chunk
+    static uint32_t Extend(const uint32_t& crc, const void* data, const size_t& size);
+    // Extend with the slicing-by-8 tables whatever the CPU, to check the
+    // selected kernel against
+    static uint32_t ExtendPortable(const uint32_t& crc, const void* data, const size_t& size);
+
+    static const char* KernelName();
+};
+
+#endif // CRC32C_HPP
\ No newline at end of file
@@ -1,8 +1,13 @@
 #ifndef PROTOCOL_HPP
 #define PROTOCOL_HPP
 
-constexpr uint32_t PROTOCOL_VERSION_MAJOR = 1;
-constexpr uint32_t PROTOCOL_VERSION_MINOR = 0; 
+#include "WireCodec.hpp"
+
+// Every message is encoded with WireCodec: packed, little-endian, fields in
+// the order Fields() lists them. RESPONSE payloads, missed packet numbers
+// and query results are little-endian too.
+constexpr uint32_t PROTOCOL_VERSION_MAJOR = 2;
+constexpr uint32_t PROTOCOL_VERSION_MINOR = 7;
 
 enum class MessageType : uint8_t {
     ERROR_CODE = 0,
@@ -10,24 +15,98 @@ enum class MessageType : uint8_t {
     ACKNOWLEDGE = 2,
     RESPONSE = 3,
     MISSED_PACKETS = 4,
-    CONNECT = 5
+    CONNECT = 5,
+    SEED_RESPONSE = 6,
+    QUERY = 7,
+    QUERY_RESULT = 8,
+    // Several messages for the same peer in one datagram, see Bundle.hpp
+    BUNDLE = 9,
+    BATCH_REQUEST = 10,
+    CUMULATIVE_ACK = 11,
+    SUBSCRIBE = 12,
+    UNSUBSCRIBE = 13,
+    STREAM_DATA = 14,
+    STREAM_REPORT = 15
 };
 
 enum class ErrorCode : uint8_t {
     INVALID_VERSION = 0,
     INVALID_VALUE = 1,
-    INVALID_HEADER = 2
+    INVALID_HEADER = 2,
+    INVALID_SESSION = 3,
+    SERVER_BUSY = 4
 };
 
 struct ErrorHeader {
     ErrorCode error;
     uint8_t version_major;
     uint8_t version_minor;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ErrorHeader::error, &ErrorHeader::version_major, &ErrorHeader::version_minor);
+    }
 };
 
+// Optional features a session can use; a REQUEST flag for a feature only
+// takes effect when the session agreed on it
+constexpr uint32_t CAPABILITY_COMPRESSED = 0x01;
+constexpr uint32_t CAPABILITY_REDUCED_PRECISION = 0x02;
+constexpr uint32_t CAPABILITY_CHECKSUMS = 0x04;
+constexpr uint32_t CAPABILITY_SEED_RESPONSES = 0x08;
+constexpr uint32_t CAPABILITY_BUNDLES = 0x10;
+constexpr uint32_t CAPABILITY_BATCH_REQUESTS = 0x20;
+constexpr uint32_t CAPABILITY_FLOW_CONTROL = 0x40;
+constexpr uint32_t CAPABILITY_BEST_EFFORT = 0x80;
+constexpr uint32_t CAPABILITY_SUBSCRIPTIONS = 0x100;
+// What peers before 2.2, which negotiate nothing, can handle
+constexpr uint32_t LEGACY_CAPABILITIES = CAPABILITY_COMPRESSED | CAPABILITY_REDUCED_PRECISION | CAPABILITY_CHECKSUMS
+                                       | CAPABILITY_SEED_RESPONSES;
+
+// Packet sizes (header and payload; trailers come on top) a session can
+// agree on. The payload of a fragment is always a whole number of doubles
+constexpr uint32_t DEFAULT_PACKET_SIZE = 2048;
+constexpr uint32_t MIN_PACKET_SIZE = 512;
+constexpr uint32_t MAX_NEGOTIATED_PACKET_SIZE = 65488;
+
+// Sent by the client with CONNECT, and by the server after the
+// AcknowledgeHeader of its answer with the version of the server and what
+// the session agreed on: the common capabilities and the smaller packet
+// size. Clients before 2.2 send only the version; their sessions get the
+// server's LEGACY_CAPABILITIES and DEFAULT_PACKET_SIZE, and they ignore the
+// extra bytes of the answer. Any minor version of the same major is served.
+// receive_window, since 2.5, is the client's initial receiver window in
+// fragments and is echoed back; a window of 0 turns flow control off
 struct ConnectHeader {
     uint8_t version_major;
     uint8_t version_minor;
+    uint32_t capabilities;
+    uint16_t max_packet_size;
+    uint16_t receive_window;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ConnectHeader::version_major, &ConnectHeader::version_minor,
+                               &ConnectHeader::capabilities, &ConnectHeader::max_packet_size,
+                               &ConnectHeader::receive_window);
+    }
+};
+
+// How a RESPONSE fragment carries its values, see FragmentCodec. FLOAT32
+// and FIXED32 items take four bytes, so those fragments hold twice as many
+// values as RAW and DELTA ones
+enum class FragmentEncoding : uint8_t {
+    RAW = 0,
+    DELTA = 1,
+    FLOAT32 = 2,
+    FIXED32 = 3
+};
+
+// Value format a REQUEST asks for. FIXED32 values are signed multiples of
+// FragmentCodec::FixedScale(|value|). Reduced precisions keep the values
+// distinct; ranges too dense for that are refused with INVALID_VALUE
+enum class ValuePrecision : uint8_t {
+    FLOAT64 = 0,
+    FLOAT32 = 1,
+    FIXED32 = 2
 };
 
 struct ProtocolHeader {
@@ -35,25 +114,251 @@ struct ProtocolHeader {
     uint16_t packets_total;
     uint16_t data_size;
     MessageType type;
+    // RESPONSE only, RAW for every other message
+    FragmentEncoding encoding;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ProtocolHeader::packet_number, &ProtocolHeader::packets_total,
+                               &ProtocolHeader::data_size, &ProtocolHeader::type, &ProtocolHeader::encoding);
+    }
 };
 
+// RequestHeader::flags
+constexpr uint8_t REQUEST_FLAG_SEED_ONLY = 0x01;
+constexpr uint8_t REQUEST_FLAG_SORT_DESCENDING = 0x02;
+// Fragments may be sent with a compact encoding; each one still holds the
+// same values as its raw counterpart, so packet numbering is unchanged
+constexpr uint8_t REQUEST_FLAG_COMPRESSED = 0x04;
+// Fragments end with a FragmentChecksum, and the final one also carries the
+// DatasetDigest of the whole response
+constexpr uint8_t REQUEST_FLAG_CHECKSUMS = 0x08;
+// The response goes out once and the server keeps nothing for resends: no
+// dataset, no retention and no probes, and no flow control either, since the
+// window needs that state. MISSED_PACKETS for it get INVALID_SESSION; the
+// client keeps what arrived
+constexpr uint8_t REQUEST_FLAG_BEST_EFFORT = 0x10;
+
 struct RequestHeader {
-    uint8_t client_id;
+    uint32_t client_id;
     double value;
+    uint8_t flags;
+    ValuePrecision precision;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&RequestHeader::client_id, &RequestHeader::value, &RequestHeader::flags,
+                               &RequestHeader::precision);
+    }
+};
+
+// Datasets for several values in one transfer. `values` little-endian
+// doubles follow the header, each answered like a REQUEST for it with the
+// same flags and precision; SEED_ONLY is not supported. The answer is one
+// RESPONSE transfer made of a sub-stream per value, in request order. Every
+// sub-stream takes packets_total / values fragments and starts on a fragment
+// of its own, so fragment n belongs to value (n - 1) / (packets_total / values).
+// One MISSED_PACKETS list and one ACKNOWLEDGE cover the whole transfer, and
+// the DatasetDigest covers all sub-streams in fragment order
+constexpr uint32_t MAX_BATCH_VALUES = 16;
+
+struct BatchRequestHeader {
+    uint32_t client_id;
+    uint8_t flags;
+    ValuePrecision precision;
+    uint16_t values;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&BatchRequestHeader::client_id, &BatchRequestHeader::flags,
+                               &BatchRequestHeader::precision, &BatchRequestHeader::values);
+    }
+};
+
+// Trailers of a RESPONSE fragment, after the data_size payload bytes:
+// [DatasetDigest, final fragment only] FragmentChecksum.
+// The checksum is the CRC-32C of every byte of the datagram before it
+struct FragmentChecksum {
+    uint32_t crc;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&FragmentChecksum::crc);
+    }
+};
+
+// CRC-32C of the payloads of all fragments in order, taken before any
+// compact encoding, i.e. of every value of the response in wire format
+struct DatasetDigest {
+    uint32_t crc;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&DatasetDigest::crc);
+    }
 };
 
 struct AcknowledgeHeader {
-    uint8_t client_id;
+    uint32_t client_id;
     uint16_t received_packet_number;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&AcknowledgeHeader::client_id, &AcknowledgeHeader::received_packet_number);
+    }
 };
 
-struct ResponseHeader {
-    char* data;
+// Sent by the client while a RESPONSE transfer of a flow controlled session
+// is under way: every fragment up to received_through has arrived, and the
+// server may send fragments up to received_through + window. Unlike
+// ACKNOWLEDGE it keeps the session open. Clients send one whenever the window
+// moved by a quarter, on duplicate fragments and along with MISSED_PACKETS
+struct CumulativeAckHeader {
+    uint32_t client_id;
+    uint16_t received_through;
+    uint16_t window;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&CumulativeAckHeader::client_id, &CumulativeAckHeader::received_through,
+                               &CumulativeAckHeader::window);
+    }
+};
+
+// Sent instead of RESPONSE fragments when the client asked for
+// REQUEST_FLAG_SEED_ONLY; the client rebuilds the values with the shared
+// generator of the given version
+struct SeedResponseHeader {
+    uint32_t generator_version;
+    uint32_t count;
+    uint64_t seed;
+    double min;
+    double max;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&SeedResponseHeader::generator_version, &SeedResponseHeader::count,
+                               &SeedResponseHeader::seed, &SeedResponseHeader::min, &SeedResponseHeader::max);
+    }
+};
+
+enum class QueryKind : uint8_t {
+    SUMMARY = 0,
+    TOP_K = 1,
+    HISTOGRAM = 2,
+    QUANTILES = 3
+};
+
+// Runs a reduction over the dataset a REQUEST with the same value would get
+// and answers with one QUERY_RESULT datagram. parameter is K for TOP_K, the
+// bin count for HISTOGRAM and the number of intervals for QUANTILES
+struct QueryHeader {
+    uint32_t client_id;
+    double value;
+    QueryKind kind;
+    uint32_t parameter;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&QueryHeader::client_id, &QueryHeader::value, &QueryHeader::kind,
+                               &QueryHeader::parameter);
+    }
+};
+
+// Followed by `items` entries: one SummaryResult, K doubles (descending),
+// bin counts as uint32_t over [-|value|, |value|), or quantile doubles
+struct QueryResultHeader {
+    QueryKind kind;
+    uint32_t items;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&QueryResultHeader::kind, &QueryResultHeader::items);
+    }
+};
+
+struct SummaryResult {
+    uint64_t count;
+    double sum;
+    double mean;
+    double min;
+    double max;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&SummaryResult::count, &SummaryResult::sum, &SummaryResult::mean, &SummaryResult::min,
+                               &SummaryResult::max);
+    }
+};
+
+// Starts an unbounded stream of freshly generated values in
+// [-|value|, |value|) at `rate` values per second, sent as STREAM_DATA until
+// UNSUBSCRIBE or the end of the session. A new SUBSCRIBE replaces the
+// running subscription and restarts its sequence numbers
+struct SubscribeHeader {
+    uint32_t client_id;
+    double value;
+    uint32_t rate;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&SubscribeHeader::client_id, &SubscribeHeader::value, &SubscribeHeader::rate);
+    }
+};
+
+struct UnsubscribeHeader {
+    uint32_t client_id;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&UnsubscribeHeader::client_id);
+    }
+};
+
+// Followed by `values` little-endian doubles. Sequence numbers count the
+// datagrams of a subscription from 0 and are never resent; a gap means
+// datagrams were lost or values were skipped by a server falling behind
+struct StreamDataHeader {
+    uint32_t sequence;
+    uint32_t values;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&StreamDataHeader::sequence, &StreamDataHeader::values);
+    }
+};
+
+// Sent by subscribers about once a second, which also keeps the session
+// alive: the highest sequence number seen and how many datagrams below it
+// never arrived
+struct StreamReportHeader {
+    uint32_t client_id;
+    uint32_t highest_sequence;
+    uint32_t missed;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&StreamReportHeader::client_id, &StreamReportHeader::highest_sequence,
+                               &StreamReportHeader::missed);
+    }
 };
 
 struct MissedPacketsHeader {
-    uint8_t client_id;
+    uint32_t client_id;
     uint16_t total_packets_missed;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&MissedPacketsHeader::client_id, &MissedPacketsHeader::total_packets_missed);
+    }
 };
 
+// Packed sizes; a failing check means the wire format changed
+static_assert(WireCodec<ProtocolHeader>::SIZE == 8, "ProtocolHeader wire size");
+static_assert(WireCodec<ErrorHeader>::SIZE == 3, "ErrorHeader wire size");
+static_assert(WireCodec<ConnectHeader>::SIZE == 10, "ConnectHeader wire size");
+static_assert(WireCodec<RequestHeader>::SIZE == 14, "RequestHeader wire size");
+static_assert(WireCodec<BatchRequestHeader>::SIZE == 8, "BatchRequestHeader wire size");
+static_assert(WireCodec<AcknowledgeHeader>::SIZE == 6, "AcknowledgeHeader wire size");
+static_assert(WireCodec<CumulativeAckHeader>::SIZE == 8, "CumulativeAckHeader wire size");
+static_assert(WireCodec<SeedResponseHeader>::SIZE == 32, "SeedResponseHeader wire size");
+static_assert(WireCodec<QueryHeader>::SIZE == 17, "QueryHeader wire size");
+static_assert(WireCodec<QueryResultHeader>::SIZE == 5, "QueryResultHeader wire size");
+static_assert(WireCodec<SummaryResult>::SIZE == 40, "SummaryResult wire size");
+static_assert(WireCodec<MissedPacketsHeader>::SIZE == 6, "MissedPacketsHeader wire size");
+static_assert(WireCodec<SubscribeHeader>::SIZE == 16, "SubscribeHeader wire size");
+static_assert(WireCodec<UnsubscribeHeader>::SIZE == 4, "UnsubscribeHeader wire size");
+static_assert(WireCodec<StreamDataHeader>::SIZE == 8, "StreamDataHeader wire size");
+static_assert(WireCodec<StreamReportHeader>::SIZE == 12, "StreamReportHeader wire size");
+static_assert(WireCodec<FragmentChecksum>::SIZE == 4, "FragmentChecksum wire size");
+static_assert(WireCodec<DatasetDigest>::SIZE == 4, "DatasetDigest wire size");
+
+constexpr uint32_t PROTOCOL_HEADER_SIZE = WireCodec<ProtocolHeader>::SIZE;
+// Room a RESPONSE datagram needs beyond header and payload
+constexpr uint32_t MAX_TRAILER_SIZE = WireCodec<DatasetDigest>::SIZE + WireCodec<FragmentChecksum>::SIZE;
+
 #endif // PROTOCOL_HPP
\ No newline at end of file
@@ -2,6 +2,20 @@
 
 Client::Client()
     : counter(0)
+    , written_packets(0)
+    , values_per_packet((DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE) / sizeof(double))
+    , part_packets(0)
+    , capabilities(0)
+    , packet_data_size(DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE)
+    , receive_window(0)
+    , received_through(0)
+    , advertised_through(0)
+    , highest_received(0)
+    , response_precision(ValuePrecision::FLOAT64)
+    , reliability(Reliability::FULL)
+    , digest_received(false)
+    , digest(0)
+    , written_values(0)
     , logger("logs.txt")
     , reader("./") {
     if (Initialize()) {
@@ -31,6 +45,10 @@ bool Client::Initialize() {
     #endif
     conf = reader.ReadServerConfig();
 
+    // Responses arrive as a burst of datagrams; give the kernel room to queue them
+    int receive_buffer = RECEIVE_BUFFER_SIZE;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receive_buffer), sizeof(receive_buffer));
+
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = inet_addr(conf.server_ip.c_str()); // Change to server IP address
@@ -53,8 +71,11 @@ bool Client::Run() {
 
     //Send connection request
     ConnectHeader c_header;
-    c_header.version_major = 1;
-    c_header.version_minor = 0;
+    c_header.version_major = PROTOCOL_VERSION_MAJOR;
+    c_header.version_minor = PROTOCOL_VERSION_MINOR;
+    c_header.capabilities = Capabilities();
+    c_header.max_packet_size = std::min(std::max(conf.max_packet_size, MIN_PACKET_SIZE), MAX_NEGOTIATED_PACKET_SIZE);
+    c_header.receive_window = ReceiveWindow(c_header.max_packet_size);
     logger.Log("Send Connect");
 
     std::chrono::time_point<std::chrono::system_clock> start, end;
@@ -70,22 +91,47 @@ bool Client::Run() {
             
             start = std::chrono::system_clock::now();
             while (true) {
-                if (poll(pollStruct, 1, 1000) == 1) {
-                    int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&server_addr, &len);
-                    ProtocolHeader* p_header = reinterpret_cast<ProtocolHeader*>(buffer);
-                    if (p_header->type != MessageType::ACKNOWLEDGE) {
-                        if (p_header->type == MessageType::ERROR_CODE) {
-                            ErrorHeader* e_header = reinterpret_cast<ErrorHeader*>(buffer + sizeof(ProtocolHeader));
-                            HandleError(*e_header);
+                if (Poll(1000)) {
+                    int n = Receive();
+                    if (n < static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<ErrorHeader>::SIZE)) {
+                        logger.Log("Unexpected Message");
+                        break;
+                    }
+                    MessageType type = WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>();
+                    if (type != MessageType::ACKNOWLEDGE) {
+                        if (type == MessageType::ERROR_CODE) {
+                            HandleError(WireCodec<ErrorHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE));
                             break;   
                         }
                         logger.Log("Unexpected Message");
                         break;
                     }
-                    AcknowledgeHeader* a_header = reinterpret_cast<AcknowledgeHeader*>(buffer + sizeof(ProtocolHeader));
-                    client_id = a_header->client_id;
+                    if (n < static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<AcknowledgeHeader>::SIZE)) {
+                        logger.Log("Unexpected Message");
+                        break;
+                    }
+                    client_id = WireView<AcknowledgeHeader>(buffer + PROTOCOL_HEADER_SIZE).Get<&AcknowledgeHeader::client_id>();
+                    // Servers before 2.2 answer with the AcknowledgeHeader
+                    // alone; they take every flag and send DEFAULT_PACKET_SIZE
+                    constexpr size_t SESSION_OFFSET = PROTOCOL_HEADER_SIZE + WireCodec<AcknowledgeHeader>::SIZE;
+                    if (n >= static_cast<int>(SESSION_OFFSET + WireCodec<ConnectHeader>::OFFSET<4>)) {
+                        ConnectHeader session = WireCodec<ConnectHeader>::DecodePrefix(buffer + SESSION_OFFSET, n - SESSION_OFFSET);
+                        capabilities = session.capabilities & Capabilities();
+                        if (session.max_packet_size >= MIN_PACKET_SIZE && session.max_packet_size <= c_header.max_packet_size) {
+                            packet_data_size = session.max_packet_size - PROTOCOL_HEADER_SIZE;
+                        }
+                        if (session.receive_window == 0) {
+                            capabilities &= ~CAPABILITY_FLOW_CONTROL;
+                        }
+                        // The agreed packets may be smaller than asked for
+                        receive_window = ReceiveWindow(PROTOCOL_HEADER_SIZE + packet_data_size);
+                    } else {
+                        capabilities = LEGACY_CAPABILITIES;
+                    }
                     ack_received = true;
-                    logger.Log("Ack received, client_id = " + client_id);
+                    logger.Log("Ack received, client_id = " + std::to_string(client_id) + ", capabilities = "
+                               + std::to_string(capabilities) + ", packet size = "
+                               + std::to_string(PROTOCOL_HEADER_SIZE + packet_data_size));
                     break;
                 } else {
                     end = std::chrono::system_clock::now();
@@ -107,60 +153,182 @@ bool Client::Run() {
     }
     sleep(3);
 
+    if (conf.subscribe_rate > 0) {
+        return RunSubscription();
+    }
+
+    // Queries get a summary computed on the server instead of the dataset
+    if (!conf.query.empty()) {
+        return RunQuery();
+    }
+
     // Send message to server
     RequestHeader r_header;
     r_header.client_id = client_id;
     r_header.value = conf.value;;
-    PrepareDataToSend(r_header, MessageType::REQUEST);
+    r_header.flags = 0;
+    // Features the server did not agree on are left out instead of being
+    // asked for and ignored
+    if (!conf.batch_values.empty()) {
+        if (!(capabilities & CAPABILITY_BATCH_REQUESTS) || conf.batch_values.size() > MAX_BATCH_VALUES) {
+            logger.Log("Server can't answer a batch of " + std::to_string(conf.batch_values.size()) + " values");
+            return false;
+        }
+        if (conf.seed_only) {
+            logger.Log("Batches are sent in full, requesting full data");
+            conf.seed_only = false;
+        }
+    }
+    if (conf.seed_only) {
+        if (capabilities & CAPABILITY_SEED_RESPONSES) {
+            r_header.flags |= REQUEST_FLAG_SEED_ONLY;
+        } else {
+            logger.Log("Server doesn't send seed responses, requesting full data");
+        }
+    }
+    if (conf.server_sort) {
+        r_header.flags |= REQUEST_FLAG_SORT_DESCENDING;
+    }
+    if (conf.compressed && (capabilities & CAPABILITY_COMPRESSED)) {
+        r_header.flags |= REQUEST_FLAG_COMPRESSED;
+    }
+    if (conf.checksums) {
+        if (capabilities & CAPABILITY_CHECKSUMS) {
+            r_header.flags |= REQUEST_FLAG_CHECKSUMS;
+        } else {
+            logger.Log("Server doesn't send checksums, receiving without them");
+            conf.checksums = false;
+        }
+    }
+    if (conf.precision == "float64") {
+        r_header.precision = ValuePrecision::FLOAT64;
+    } else if (conf.precision == "float32") {
+        r_header.precision = ValuePrecision::FLOAT32;
+    } else if (conf.precision == "fixed32") {
+        r_header.precision = ValuePrecision::FIXED32;
+    } else {
+        logger.Log("Unknown precision: " + conf.precision);
+        return false;
+    }
+    if (r_header.precision != ValuePrecision::FLOAT64 && !(capabilities & CAPABILITY_REDUCED_PRECISION)) {
+        logger.Log("Server doesn't narrow values, requesting float64");
+        r_header.precision = ValuePrecision::FLOAT64;
+    }
+    if (conf.reliability == "full") {
+        reliability = Reliability::FULL;
+    } else if (conf.reliability == "bounded") {
+        reliability = Reliability::BOUNDED;
+    } else if (conf.reliability == "best_effort") {
+        reliability = Reliability::BEST_EFFORT;
+        if (capabilities & CAPABILITY_BEST_EFFORT) {
+            r_header.flags |= REQUEST_FLAG_BEST_EFFORT;
+            // The server sends best-effort responses without a window
+            capabilities &= ~CAPABILITY_FLOW_CONTROL;
+        } else {
+            logger.Log("Server doesn't send best-effort responses, not asking for resends anyway");
+        }
+    } else {
+        logger.Log("Unknown reliability: " + conf.reliability);
+        return false;
+    }
+    deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(conf.deadline_ms);
+    SendRequest(r_header);
+    uint32_t request_retries = retries;
 
-    uint32_t packet_data_size = BUFFER_SIZE - sizeof(ProtocolHeader);
     uint32_t total_packets_expected = 0;
     len = sizeof(server_addr);
 
-    ProtocolHeader* p_header;
+    ProtocolHeader p_header;
     start = std::chrono::system_clock::now();
     while (true) {
         pollStruct[0].fd = sockfd;
         pollStruct[0].events = POLLIN;
-        if (poll(pollStruct, 1, 1000) == 1) {
-            int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&server_addr, &len);
-            p_header = reinterpret_cast<ProtocolHeader*>(buffer);
-            if (p_header->type != MessageType::RESPONSE) {
-                if (p_header->type == MessageType::ERROR_CODE) {
-                    ErrorHeader* e_header = reinterpret_cast<ErrorHeader*>(buffer + sizeof(ProtocolHeader));
-                    HandleError(*e_header);
+        if (Poll(PollTimeout())) {
+            int n = Receive();
+            if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)) {
+                continue;
+            }
+            p_header = WireCodec<ProtocolHeader>::Decode(buffer);
+            if (p_header.type == MessageType::SEED_RESPONSE && n >= static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<SeedResponseHeader>::SIZE)) {
+                if (RebuildFromSeed(WireCodec<SeedResponseHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE))) {
                     break;
                 }
+                // Fall back to a regular transfer
+                logger.Log("Can't rebuild response from seed, requesting full data");
+                r_header.flags &= ~REQUEST_FLAG_SEED_ONLY;
+                SendRequest(r_header);
+                start = std::chrono::system_clock::now();
+                continue;
+            }
+            if (p_header.type != MessageType::RESPONSE) {
+                if (p_header.type == MessageType::ERROR_CODE) {
+                    HandleError(WireCodec<ErrorHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE));
+                    break;
+                }
+            }
+
+            uint32_t payload_size = 0;
+            if (!CheckFragment(buffer, n, p_header, payload_size)) {
+                continue;
             }
-            
             ++counter;
             if (counter == 1) {
-                arr.resize(p_header->packets_total * packet_data_size / sizeof(double));
-                packets_received.resize(p_header->packets_total + 1);
-                total_packets_expected = p_header->packets_total;
+                // Narrowed fragments hold more values; the server may also
+                // have answered in full precision
+                values_per_packet = packet_data_size / FragmentCodec::ValueSize(p_header.encoding);
+                response_precision = p_header.encoding == FragmentEncoding::FLOAT32 ? ValuePrecision::FLOAT32
+                                   : p_header.encoding == FragmentEncoding::FIXED32 ? ValuePrecision::FIXED32
+                                   : ValuePrecision::FLOAT64;
+                arr.resize(static_cast<size_t>(p_header.packets_total) * values_per_packet);
+                packets_received.resize(p_header.packets_total + 1);
+                if (!conf.batch_values.empty()) {
+                    // Every value's sub-stream takes the same number of fragments
+                    part_packets = p_header.packets_total / conf.batch_values.size();
+                    if (part_packets == 0 || p_header.packets_total % conf.batch_values.size() != 0) {
+                        logger.Log("Malformed batch response");
+                        return false;
+                    }
+                    part_values.assign(conf.batch_values.size(), 0);
+                }
+                total_packets_expected = p_header.packets_total;
                 elapsed_seconds = std::chrono::duration<double>(1);
             }
 
-            offset = packet_data_size * (p_header->packet_number - 1);
-            memcpy(arr.data() + (offset/sizeof(double)), buffer + sizeof(ProtocolHeader), n - sizeof(ProtocolHeader));
-            packets_received[p_header->packet_number] = true;
+            offset = packet_data_size * (p_header.packet_number - 1);
+            const bool duplicate = p_header.packet_number < packets_received.size() && packets_received[p_header.packet_number];
+            uint32_t values = StoreFragment(p_header, buffer + PROTOCOL_HEADER_SIZE, payload_size);
+            if (values > 0) {
+                packets_received[p_header.packet_number] = true;
+                AdvanceWindow(p_header.packet_number, duplicate);
+            }
             std::ostringstream oss;
-            oss << "On " << offset << " Received bytes " << n - sizeof(ProtocolHeader) << " Packet number " << p_header->packet_number;
+            oss << "On " << offset << " Received bytes " << payload_size << " Packet number " << p_header.packet_number;
             logger.Log(oss.str());
-            if (p_header->packets_total == p_header->packet_number) {
-                arr.resize((((p_header->packets_total - 1) * packet_data_size) + n - sizeof(ProtocolHeader)) / sizeof(double));
+            bool last_packet = p_header.packets_total == p_header.packet_number;
+            RecordFragmentValues(p_header, values);
+            if (conf.server_sort && part_packets == 0) {
+                WriteReceived();
+            }
+            if (last_packet || PastDeadline()) {
                 break;
             }
             start = std::chrono::system_clock::now();
         } else {
             end = std::chrono::system_clock::now();
-            if (end - start >= elapsed_seconds) {
+            if (end - start >= elapsed_seconds || PastDeadline()) {
+                // Nothing arrived at all, e.g. a lost seed response; ask again
+                if (counter == 0 && request_retries > 0 && !PastDeadline()) {
+                    --request_retries;
+                    SendRequest(r_header);
+                    start = std::chrono::system_clock::now();
+                    continue;
+                }
                 break;
             }
         }
     }
     std::vector<uint16_t> missed_packets;
-    for(short i = 1; i < packets_received.size(); ++i) {
+    for(uint32_t i = 1; i < packets_received.size(); ++i) {
         if(packets_received[i] == false) {
             missed_packets.push_back(i);
         }
@@ -169,45 +337,59 @@ bool Client::Run() {
         AcknowledgeHeader a_header;
         a_header.client_id = client_id;
         PrepareDataToSend(a_header, MessageType::ACKNOWLEDGE);
-    } else {
-        for(int i = 0; i < retries; ++i) {
-            PrepareMissingPackets(missed_packets, client_id);
+    } else if (reliability != Reliability::BEST_EFFORT) {
+        for(int i = 0; i < retries && !PastDeadline(); ++i) {
+            ReportMissing(missed_packets);
             start = std::chrono::system_clock::now();
             while (true) {
                 pollStruct[0].fd = sockfd;
                 pollStruct[0].events = POLLIN;
-                if (poll(pollStruct, 1, 1000) == 1) {
-                    int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&server_addr, &len);
-                    p_header = reinterpret_cast<ProtocolHeader*>(buffer);
-                    if (p_header->type != MessageType::RESPONSE) {
-                        if (p_header->type == MessageType::ERROR_CODE) {
-                            ErrorHeader* e_header = reinterpret_cast<ErrorHeader*>(buffer + sizeof(ProtocolHeader));
-                            HandleError(*e_header);
+                if (Poll(PollTimeout())) {
+                    int n = Receive();
+                    if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)) {
+                        continue;
+                    }
+                    p_header = WireCodec<ProtocolHeader>::Decode(buffer);
+                    if (p_header.type != MessageType::RESPONSE) {
+                        if (p_header.type == MessageType::ERROR_CODE) {
+                            HandleError(WireCodec<ErrorHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE));
                             break;
                         }
                     }
-                    
+
+                    uint32_t payload_size = 0;
+                    if (!CheckFragment(buffer, n, p_header, payload_size)) {
+                        continue;
+                    }
                     ++counter;
-                    offset = packet_data_size * (p_header->packet_number - 1);
-                    memcpy(arr.data() + (offset/sizeof(double)), buffer + sizeof(ProtocolHeader), n - sizeof(ProtocolHeader));
-                    packets_received[p_header->packet_number] = true;
+                    offset = packet_data_size * (p_header.packet_number - 1);
+                    const bool duplicate = p_header.packet_number < packets_received.size() && packets_received[p_header.packet_number];
+                    uint32_t values = StoreFragment(p_header, buffer + PROTOCOL_HEADER_SIZE, payload_size);
+                    if (values > 0) {
+                        packets_received[p_header.packet_number] = true;
+                        AdvanceWindow(p_header.packet_number, duplicate);
+                    }
                     std::ostringstream oss;
-                    oss << "On " << offset << " Received bytes " << n - sizeof(ProtocolHeader) << " Packet number " << p_header->packet_number;
+                    oss << "On " << offset << " Received bytes " << payload_size << " Packet number " << p_header.packet_number;
                     logger.Log(oss.str());
-                    if (total_packets_expected == p_header->packet_number) {
-                        arr.resize((((p_header->packets_total - 1) * packet_data_size) + n - sizeof(ProtocolHeader)) / sizeof(double));
+                    bool last_packet = total_packets_expected == p_header.packet_number;
+                    RecordFragmentValues(p_header, values);
+                    if (conf.server_sort && part_packets == 0) {
+                        WriteReceived();
+                    }
+                    if (last_packet || PastDeadline()) {
                         break;
                     }
                     start = std::chrono::system_clock::now();
                 } else {
                     end = std::chrono::system_clock::now();
-                    if (end - start >= elapsed_seconds) {
+                    if (end - start >= elapsed_seconds || PastDeadline()) {
                         break;
                     }
                 }
             }
             missed_packets.clear();
-            for(short i = 1; i < packets_received.size(); ++i) {
+            for(uint32_t i = 1; i < packets_received.size(); ++i) {
                 if(packets_received[i] == false) {
                     missed_packets.push_back(i);
                 }
@@ -218,29 +400,251 @@ bool Client::Run() {
         }
     }
 
-    if (missed_packets.size() == 0) {
-        AcknowledgeHeader a_header;
-        a_header.client_id = client_id;
-        PrepareDataToSend(a_header, MessageType::ACKNOWLEDGE);
-    } else {
+    const bool partial = missed_packets.size() != 0;
+    if (counter == 0 && reliability != Reliability::FULL && PastDeadline()) {
+        logger.Log("Nothing arrived by the deadline");
+        return false;
+    }
+    if (partial && reliability == Reliability::FULL) {
         logger.Log("Can't retrieve missing packets");
         return false;
     }
+    // A partial response ends the transfer all the same
+    AcknowledgeHeader a_header;
+    a_header.client_id = client_id;
+    PrepareDataToSend(a_header, MessageType::ACKNOWLEDGE);
 
-    std::sort(arr.begin(), arr.end(), std::greater<>());
+    if (partial) {
+        logger.Log("Partial response, " + std::to_string(missed_packets.size()) + " of "
+                   + std::to_string(packets_received.size() - 1) + " fragments missing");
+        WriteGaps(missed_packets);
+        DropMissing();
+    } else if (part_packets != 0) {
+        CompactBatch();
+    }
+    // The digest covers the whole response
+    if (conf.checksums && counter > 0 && !partial && !VerifyDigest()) {
+        return false;
+    }
+    if (part_packets != 0) {
+        WriteBatch();
+        return true;
+    }
 
-    std::ofstream fout("result");
-    std::string binary;
-    for(int i = 0; i < arr.size(); ++i) {
-        std::string binary = std::bitset<sizeof(double) * 8>(arr[i]).to_string();
-        fout.write(binary.c_str(), binary.length());
+    // A server-sorted response is already descending and mostly written
+    if (!conf.server_sort) {
+        std::sort(arr.begin(), arr.end(), std::greater<>());
     }
-    
+    WriteValues(arr.size());
     fout.close();
 
     return true;
 }
 
+uint32_t Client::Capabilities() {
+    return CAPABILITY_COMPRESSED | CAPABILITY_REDUCED_PRECISION | CAPABILITY_CHECKSUMS | CAPABILITY_SEED_RESPONSES
+         | CAPABILITY_BUNDLES | CAPABILITY_BATCH_REQUESTS | CAPABILITY_FLOW_CONTROL
+         | CAPABILITY_BEST_EFFORT | CAPABILITY_SUBSCRIPTIONS;
+}
+
+bool Client::CheckFragment(const char* datagram, const uint32_t& size, const ProtocolHeader& header, uint32_t& payload_size) {
+    // Trailers follow the data_size payload bytes. A fragment failing its
+    // checksum is dropped and later requested again like a lost one
+    payload_size = std::min<uint32_t>(header.data_size, size - PROTOCOL_HEADER_SIZE);
+    const uint32_t trailer_size = size - PROTOCOL_HEADER_SIZE - payload_size;
+    if (!conf.checksums || trailer_size < WireCodec<FragmentChecksum>::SIZE) {
+        return true;
+    }
+    const uint32_t checked = size - WireCodec<FragmentChecksum>::SIZE;
+    if (Crc32c::Compute(datagram, checked) != WireView<FragmentChecksum>(datagram + checked).Get<&FragmentChecksum::crc>()) {
+        logger.Log("Checksum mismatch in fragment " + std::to_string(header.packet_number));
+        return false;
+    }
+    if (trailer_size >= MAX_TRAILER_SIZE) {
+        digest = WireView<DatasetDigest>(datagram + PROTOCOL_HEADER_SIZE + payload_size).Get<&DatasetDigest::crc>();
+        digest_received = true;
+    }
+    return true;
+}
+
+uint32_t Client::StoreFragment(const ProtocolHeader& header, const char* payload, const uint32_t& size) {
+    // Fragment n holds values [(n - 1) * values_per_packet, ...) whatever its
+    // encoding; the server falls back to RAW when encoding does not pay off
+    const size_t first = static_cast<size_t>(header.packet_number - 1) * values_per_packet;
+    if (header.packet_number == 0 || first >= arr.size()) {
+        return 0;
+    }
+    const uint32_t capacity = std::min<size_t>(values_per_packet, arr.size() - first);
+    const double value = part_packets == 0 ? conf.value : conf.batch_values[(header.packet_number - 1) / part_packets];
+    uint32_t values = FragmentCodec::Decode(header.encoding, payload, size, arr.data() + first, capacity,
+                                            FragmentCodec::FixedScale(value));
+    if (values == 0) {
+        logger.Log("Malformed fragment " + std::to_string(header.packet_number));
+    }
+    return values;
+}
+
+// The last fragment of a response, or of a batch sub-stream, tells how many
+// values it ends with
+void Client::RecordFragmentValues(const ProtocolHeader& header, const uint32_t& values) {
+    if (values == 0) {
+        return;
+    }
+    if (part_packets == 0) {
+        if (header.packet_number == header.packets_total) {
+            arr.resize((header.packets_total - 1) * values_per_packet + values);
+        }
+        return;
+    }
+    if (header.packet_number % part_packets == 0) {
+        part_values[header.packet_number / part_packets - 1] = (part_packets - 1) * values_per_packet + values;
+    }
+}
+
+// Sub-streams end in partly filled fragments. Closing the gaps leaves arr
+// with the values in fragment order, which the digest covers
+void Client::CompactBatch() {
+    size_t end = 0;
+    for (size_t part = 0; part < part_values.size(); ++part) {
+        auto first = arr.begin() + static_cast<size_t>(part) * part_packets * values_per_packet;
+        end = std::copy(first, first + part_values[part], arr.begin() + end) - arr.begin();
+    }
+    arr.resize(end);
+}
+
+// One file per requested value: result_0, result_1, ...
+void Client::WriteBatch() {
+    auto first = arr.begin();
+    for (size_t part = 0; part < part_values.size(); ++part) {
+        auto last = first + part_values[part];
+        if (!conf.server_sort) {
+            std::sort(first, last, std::greater<>());
+        }
+        std::ofstream out("result_" + std::to_string(part));
+        for (auto it = first; it != last; ++it) {
+            std::string binary = std::bitset<sizeof(double) * 8>(*it).to_string();
+            out.write(binary.c_str(), binary.length());
+        }
+        first = last;
+    }
+}
+
+// Keeps the values of the fragments that arrived, in fragment order; the
+// gap map tells which ones are missing
+void Client::DropMissing() {
+    const uint32_t packets_total = packets_received.size() - 1;
+    const uint32_t stream_packets = part_packets == 0 ? packets_total : part_packets;
+    std::vector<uint32_t> kept(part_packets == 0 ? 1 : part_values.size(), 0);
+    size_t end = 0;
+    for (uint32_t packet_number = 1; packet_number <= packets_total; ++packet_number) {
+        if (!packets_received[packet_number]) {
+            continue;
+        }
+        const size_t stream = (packet_number - 1) / stream_packets;
+        const size_t first = static_cast<size_t>(packet_number - 1) * values_per_packet;
+        size_t count = values_per_packet;
+        if (packet_number % stream_packets == 0) {
+            // The final fragment of a stream recorded how many values it ends with
+            const size_t stream_end = part_packets == 0 ? arr.size() : stream * stream_packets * values_per_packet + part_values[stream];
+            count = stream_end - first;
+        }
+        end = std::copy(arr.begin() + first, arr.begin() + first + count, arr.begin() + end) - arr.begin();
+        kept[stream] += count;
+    }
+    arr.resize(end);
+    if (part_packets != 0) {
+        part_values = kept;
+    }
+}
+
+// Gap map of a partial response: the values a fragment holds, for batches
+// the fragments per requested value, then every missing fragment number
+void Client::WriteGaps(const std::vector<uint16_t>& missed_packets) {
+    std::ofstream out("gaps");
+    out << "values_per_fragment " << values_per_packet << "\n";
+    if (part_packets != 0) {
+        out << "fragments_per_value " << part_packets << "\n";
+    }
+    for (const uint16_t& packet_number : missed_packets) {
+        out << packet_number << "\n";
+    }
+}
+
+bool Client::PastDeadline() {
+    return reliability != Reliability::FULL && std::chrono::system_clock::now() >= deadline;
+}
+
+// Waits are cut short by the deadline of a bounded or best-effort transfer
+int Client::PollTimeout() {
+    if (reliability == Reliability::FULL) {
+        return 1000;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::system_clock::now());
+    return std::max<int>(0, std::min<int>(1000, remaining.count()));
+}
+
+bool Client::VerifyDigest() {
+    if (!digest_received) {
+        logger.Log("Response came without a dataset digest");
+        return true;
+    }
+    // The digest covers the values in wire format and fragment order, which
+    // arr holds exactly; narrowed values convert back without rounding. The
+    // sub-streams of a batch each have the fixed-point scale of their value
+    std::vector<uint32_t> spans = part_values;
+    if (part_packets == 0) {
+        spans.assign(1, arr.size());
+    }
+    const uint32_t value_size = FragmentCodec::ValueSize(response_precision);
+    char block[BUFFER_SIZE];
+    const size_t block_values = sizeof(block) / value_size;
+    uint32_t crc = 0;
+    size_t span_first = 0;
+    for (size_t span = 0; span < spans.size(); ++span) {
+        const double scale = FragmentCodec::FixedScale(part_packets == 0 ? conf.value : conf.batch_values[span]);
+        const size_t span_end = span_first + spans[span];
+        for (size_t first = span_first; first < span_end; first += block_values) {
+            const size_t count = std::min(block_values, span_end - first);
+            for (size_t i = 0; i < count; ++i) {
+                if (response_precision == ValuePrecision::FLOAT32) {
+                    Wire::Store(block + i * value_size, static_cast<float>(arr[first + i]));
+                } else if (response_precision == ValuePrecision::FIXED32) {
+                    Wire::Store(block + i * value_size, static_cast<int32_t>(arr[first + i] / scale));
+                } else {
+                    Wire::Store(block + i * value_size, arr[first + i]);
+                }
+            }
+            crc = Crc32c::Extend(crc, block, count * value_size);
+        }
+        span_first = span_end;
+    }
+    if (crc != digest) {
+        logger.Log("Dataset digest mismatch");
+        return false;
+    }
+    logger.Log("Dataset digest verified");
+    return true;
+}
+
+void Client::WriteReceived() {
+    // Fragments of a sorted response can be written out as soon as every
+    // fragment before them has arrived
+    while (written_packets + 1 < packets_received.size() && packets_received[written_packets + 1]) {
+        ++written_packets;
+    }
+    WriteValues(std::min<size_t>(static_cast<size_t>(written_packets) * values_per_packet, arr.size()));
+}
+
+void Client::WriteValues(const size_t& end) {
+    if (!fout.is_open()) {
+        fout.open("result");
+    }
+    for (; written_values < end; ++written_values) {
+        std::string binary = std::bitset<sizeof(double) * 8>(arr[written_values]).to_string();
+        fout.write(binary.c_str(), binary.length());
+    }
+}
+
 template<class T>
 bool Client::PrepareDataToSend(const T& header, const MessageType& type) {
     logger.Log(__func__);
@@ -248,39 +652,150 @@ bool Client::PrepareDataToSend(const T& header, const MessageType& type) {
     p_header.packet_number = packet_num;
     p_header.packets_total = 1;
     p_header.type = type;
-    p_header.data_size = sizeof(T);
+    p_header.encoding = FragmentEncoding::RAW;
+    p_header.data_size = WireCodec<T>::SIZE;
 
-    char buffer[sizeof(ProtocolHeader) + sizeof(T)];
-    memcpy(buffer, &p_header, sizeof(ProtocolHeader));
-    memcpy(buffer + sizeof(ProtocolHeader), &header, sizeof(T));
-    SendMessage(buffer, sizeof(ProtocolHeader) + sizeof(T));
+    char buffer[PROTOCOL_HEADER_SIZE + WireCodec<T>::SIZE];
+    WireCodec<ProtocolHeader>::Encode(p_header, buffer);
+    WireCodec<T>::Encode(header, buffer + PROTOCOL_HEADER_SIZE);
+    SendMessage(buffer, sizeof(buffer));
 
     return true;
 }
 
-bool Client::PrepareMissingPackets(const std::vector<uint16_t>& missed_packets, const uint32_t id) {
+bool Client::SendRequest(const RequestHeader& header) {
+    if (conf.batch_values.empty()) {
+        return PrepareDataToSend(header, MessageType::REQUEST);
+    }
+    return PrepareBatchRequest(header);
+}
+
+bool Client::PrepareBatchRequest(const RequestHeader& header) {
     logger.Log(__func__);
+    constexpr uint32_t HEADERS_SIZE = PROTOCOL_HEADER_SIZE + WireCodec<BatchRequestHeader>::SIZE;
+    const uint32_t count = conf.batch_values.size();
     ProtocolHeader p_header;
     p_header.packet_number = packet_num;
     p_header.packets_total = 1;
-    p_header.type = MessageType::MISSED_PACKETS;
-    p_header.data_size = (missed_packets.size()) * sizeof(uint16_t) + sizeof(MissedPacketsHeader);
-    const uint32_t buffer_size = (missed_packets.size()) * sizeof(uint16_t) + sizeof(MissedPacketsHeader) + sizeof(ProtocolHeader); 
-
-    MissedPacketsHeader m_header;
-    m_header.client_id = id;
-    m_header.total_packets_missed = missed_packets.size();
-
-    char* buffer = new char[buffer_size];
-    memcpy(buffer, &p_header, sizeof(ProtocolHeader));
-    memcpy(buffer + sizeof(ProtocolHeader), &m_header, sizeof(MissedPacketsHeader));
-    memcpy(buffer + sizeof(ProtocolHeader) + sizeof(MissedPacketsHeader), missed_packets.data(), (missed_packets.size()) * sizeof(uint16_t));
-    MissedPacketsHeader* m_header2 = reinterpret_cast<MissedPacketsHeader*>(buffer + sizeof(ProtocolHeader));
-    SendMessage(buffer, buffer_size);
-    delete buffer;
+    p_header.type = MessageType::BATCH_REQUEST;
+    p_header.encoding = FragmentEncoding::RAW;
+    p_header.data_size = WireCodec<BatchRequestHeader>::SIZE + count * sizeof(double);
+
+    BatchRequestHeader b_header;
+    b_header.client_id = header.client_id;
+    b_header.flags = header.flags;
+    b_header.precision = header.precision;
+    b_header.values = count;
+
+    char buffer[HEADERS_SIZE + MAX_BATCH_VALUES * sizeof(double)];
+    WireCodec<ProtocolHeader>::Encode(p_header, buffer);
+    WireCodec<BatchRequestHeader>::Encode(b_header, buffer + PROTOCOL_HEADER_SIZE);
+    Wire::StoreArray(buffer + HEADERS_SIZE, conf.batch_values.data(), count);
+    return SendMessage(buffer, HEADERS_SIZE + count * sizeof(double));
+}
+
+bool Client::PrepareMissingPackets(const std::vector<uint16_t>& missed_packets, const uint32_t id) {
+    logger.Log(__func__);
+    // The server reads at most BUFFER_SIZE bytes per datagram, so long lists
+    // are split over several messages
+    constexpr uint32_t HEADERS_SIZE = PROTOCOL_HEADER_SIZE + WireCodec<MissedPacketsHeader>::SIZE;
+    const uint32_t max_per_message = (BUFFER_SIZE - HEADERS_SIZE) / sizeof(uint16_t);
+    char buffer[BUFFER_SIZE];
+    for (uint32_t first = 0; first < missed_packets.size(); first += max_per_message) {
+        const uint32_t count = std::min<uint32_t>(max_per_message, missed_packets.size() - first);
+        ProtocolHeader p_header;
+        p_header.packet_number = packet_num;
+        p_header.packets_total = 1;
+        p_header.type = MessageType::MISSED_PACKETS;
+        p_header.encoding = FragmentEncoding::RAW;
+        p_header.data_size = count * sizeof(uint16_t) + WireCodec<MissedPacketsHeader>::SIZE;
+        const uint32_t buffer_size = count * sizeof(uint16_t) + HEADERS_SIZE;
+
+        MissedPacketsHeader m_header;
+        m_header.client_id = id;
+        m_header.total_packets_missed = count;
+
+        WireCodec<ProtocolHeader>::Encode(p_header, buffer);
+        WireCodec<MissedPacketsHeader>::Encode(m_header, buffer + PROTOCOL_HEADER_SIZE);
+        Wire::StoreArray(buffer + HEADERS_SIZE, missed_packets.data() + first, count);
+        if (!SendMessage(buffer, buffer_size)) {
+            return false;
+        }
+    }
     return true;
 }
 
+// Flow controlled transfers only report the gaps below the highest fragment
+// seen; the rest is still to come through the window, which is restated in
+// case the cumulative ACK that opened it was lost
+bool Client::ReportMissing(const std::vector<uint16_t>& missed_packets) {
+    if (!(capabilities & CAPABILITY_FLOW_CONTROL)) {
+        return PrepareMissingPackets(missed_packets, client_id);
+    }
+    std::vector<uint16_t> gaps;
+    for (const uint16_t& packet_number : missed_packets) {
+        if (packet_number < highest_received) {
+            gaps.push_back(packet_number);
+        }
+    }
+    if (!gaps.empty() && !PrepareMissingPackets(gaps, client_id)) {
+        return false;
+    }
+    return SendCumulativeAck();
+}
+
+// Fragments of `packet_size` bytes the socket's receive buffer holds. Linux
+// reports twice the size that was set and keeps the extra for bookkeeping
+uint32_t Client::ReceiveWindow(const uint32_t& packet_size) {
+    int receive_buffer = 0;
+    #ifdef _WIN32
+    int option_size = sizeof(receive_buffer);
+    #else
+    socklen_t option_size = sizeof(receive_buffer);
+    #endif
+    if (getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<char*>(&receive_buffer), &option_size) != 0
+        || receive_buffer <= 0) {
+        receive_buffer = RECEIVE_BUFFER_SIZE;
+    }
+    #ifdef __linux__
+    receive_buffer /= 2;
+    #endif
+    return std::min<uint32_t>(UINT16_MAX, std::max<uint32_t>(1, receive_buffer / (packet_size + MAX_TRAILER_SIZE)));
+}
+
+// Tells the server about progress once the window moved by a quarter. A
+// duplicate means the server is probing, because the window ran dry or an
+// update was lost, so it hears about the gaps and the window right away
+void Client::AdvanceWindow(const uint16_t& packet_number, const bool& duplicate) {
+    if (!(capabilities & CAPABILITY_FLOW_CONTROL)) {
+        return;
+    }
+    highest_received = std::max<uint32_t>(highest_received, packet_number);
+    while (received_through + 1 < packets_received.size() && packets_received[received_through + 1]) {
+        ++received_through;
+    }
+    if (duplicate) {
+        std::vector<uint16_t> missed_packets;
+        for (uint32_t i = received_through + 1; i < highest_received; ++i) {
+            if (!packets_received[i]) {
+                missed_packets.push_back(i);
+            }
+        }
+        ReportMissing(missed_packets);
+    } else if (received_through >= advertised_through + std::max<uint32_t>(receive_window / 4, 1)) {
+        SendCumulativeAck();
+    }
+}
+
+bool Client::SendCumulativeAck() {
+    CumulativeAckHeader header;
+    header.client_id = client_id;
+    header.received_through = received_through;
+    header.window = receive_window;
+    advertised_through = received_through;
+    return PrepareDataToSend(header, MessageType::CUMULATIVE_ACK);
+}
+
 bool Client::SendMessage(char* buffer, const uint32_t& buffer_size) {
     if (sendto(sockfd, buffer, buffer_size, 0, (struct sockaddr *)&server_addr,
         #ifdef _WIN32
@@ -302,6 +817,297 @@ bool Client::SendMessage(char* buffer, const uint32_t& buffer_size) {
     return true;
 }
 
+bool Client::Poll(const int& timeout_ms) {
+    return !bundled.empty() || poll(pollStruct, 1, timeout_ms) == 1;
+}
+
+// Reads the next message into buffer and returns its size. Messages of a
+// BUNDLE come out one by one, as if each had a datagram of its own
+int Client::Receive() {
+    if (bundled.empty()) {
+        int n = recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr *)&server_addr, &len);
+        if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)
+            || WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>() != MessageType::BUNDLE) {
+            return n;
+        }
+        BundleReader reader(buffer, n);
+        size_t offset = 0;
+        size_t size = 0;
+        while (reader.Next(offset, size)) {
+            bundled.emplace_back(buffer + offset, buffer + offset + size);
+        }
+        if (reader.Malformed()) {
+            logger.Log("Malformed bundle");
+        }
+        if (bundled.empty()) {
+            return 0;
+        }
+    }
+    const int n = bundled.front().size();
+    memcpy(buffer, bundled.front().data(), n);
+    bundled.pop_front();
+    return n;
+}
+
+bool Client::RunQuery() {
+    logger.Log(__func__);
+    QueryHeader q_header;
+    q_header.client_id = client_id;
+    q_header.value = conf.value;
+    q_header.parameter = conf.query_parameter;
+    if (conf.query == "summary") {
+        q_header.kind = QueryKind::SUMMARY;
+    } else if (conf.query == "top_k") {
+        q_header.kind = QueryKind::TOP_K;
+    } else if (conf.query == "histogram") {
+        q_header.kind = QueryKind::HISTOGRAM;
+    } else if (conf.query == "quantiles") {
+        q_header.kind = QueryKind::QUANTILES;
+    } else {
+        logger.Log("Unknown query: " + conf.query);
+        return false;
+    }
+
+    len = sizeof(server_addr);
+    for (uint32_t i = 0; i < 5; ++i) {
+        PrepareDataToSend(q_header, MessageType::QUERY);
+        pollStruct[0].fd = sockfd;
+        pollStruct[0].events = POLLIN;
+        if (!Poll(1000)) {
+            logger.Log("No query result");
+            continue;
+        }
+        int n = Receive();
+        if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)) {
+            logger.Log("Unexpected Message");
+            continue;
+        }
+        MessageType type = WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>();
+        if (type == MessageType::ERROR_CODE && n >= static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<ErrorHeader>::SIZE)) {
+            HandleError(WireCodec<ErrorHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE));
+            return false;
+        }
+        if (type != MessageType::QUERY_RESULT || n < static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<QueryResultHeader>::SIZE)) {
+            logger.Log("Unexpected Message");
+            continue;
+        }
+        if (!WriteQueryResult(buffer + PROTOCOL_HEADER_SIZE, n - PROTOCOL_HEADER_SIZE)) {
+            return false;
+        }
+
+        AcknowledgeHeader a_header;
+        a_header.client_id = client_id;
+        PrepareDataToSend(a_header, MessageType::ACKNOWLEDGE);
+        return true;
+    }
+    return false;
+}
+
+bool Client::WriteQueryResult(const char* data, const uint32_t& size) {
+    WireView<QueryResultHeader> view(data);
+    const QueryResultHeader r_header = view.Decode();
+    const char* items = view.Payload();
+    const uint32_t items_size = size - WireCodec<QueryResultHeader>::SIZE;
+
+    std::ofstream out("result");
+    out << std::setprecision(17);
+    switch (r_header.kind) {
+        case QueryKind::SUMMARY: {
+            if (items_size < WireCodec<SummaryResult>::SIZE) {
+                return false;
+            }
+            const SummaryResult summary = WireCodec<SummaryResult>::Decode(items);
+            out << "count " << summary.count << "\nsum " << summary.sum << "\nmean " << summary.mean
+                << "\nmin " << summary.min << "\nmax " << summary.max << "\n";
+            break;
+        }
+        case QueryKind::TOP_K:
+        case QueryKind::QUANTILES: {
+            uint32_t count = std::min<uint32_t>(r_header.items, items_size / sizeof(double));
+            for (uint32_t i = 0; i < count; ++i) {
+                double value;
+                Wire::Load(items + i * sizeof(double), value);
+                out << value << "\n";
+            }
+            break;
+        }
+        case QueryKind::HISTOGRAM: {
+            uint32_t count = std::min<uint32_t>(r_header.items, items_size / sizeof(uint32_t));
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t bin;
+                Wire::Load(items + i * sizeof(uint32_t), bin);
+                out << bin << "\n";
+            }
+            break;
+        }
+        default: {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Subscriptions stream values until the client unsubscribes. Lost datagrams
+// are not asked for again; their sequence numbers end up in the gap map
+bool Client::RunSubscription() {
+    logger.Log(__func__);
+    if (!(capabilities & CAPABILITY_SUBSCRIPTIONS)) {
+        logger.Log("Server doesn't stream subscriptions");
+        return false;
+    }
+    SubscribeHeader s_header;
+    s_header.client_id = client_id;
+    s_header.value = conf.value;
+    s_header.rate = conf.subscribe_rate;
+
+    len = sizeof(server_addr);
+    pollStruct[0].fd = sockfd;
+    pollStruct[0].events = POLLIN;
+    fout.open("result");
+
+    // Sequence ranges that never arrived, first and last
+    std::vector<std::pair<uint32_t, uint32_t>> gaps;
+    uint32_t next_sequence = 0;
+    uint32_t missed = 0;
+    uint64_t values = 0;
+    bool streaming = false;
+    uint32_t attempts = 1;
+    PrepareDataToSend(s_header, MessageType::SUBSCRIBE);
+
+    auto now = std::chrono::system_clock::now();
+    const auto end = now + std::chrono::seconds(conf.subscribe_seconds);
+    auto next_report = now + std::chrono::seconds(1);
+    while (now < end) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(std::min(end, next_report) - now);
+        if (!Poll(std::max<int>(1, wait.count()))) {
+            now = std::chrono::system_clock::now();
+            if (!streaming && now >= next_report) {
+                if (attempts == 5) {
+                    logger.Log("No stream data");
+                    return false;
+                }
+                ++attempts;
+                PrepareDataToSend(s_header, MessageType::SUBSCRIBE);
+                next_report = now + std::chrono::seconds(1);
+            }
+            continue;
+        }
+        int n = Receive();
+        now = std::chrono::system_clock::now();
+        if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)) {
+            logger.Log("Unexpected Message");
+            continue;
+        }
+        MessageType type = WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>();
+        if (type == MessageType::ERROR_CODE && n >= static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<ErrorHeader>::SIZE)) {
+            HandleError(WireCodec<ErrorHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE));
+            return false;
+        }
+        if (type != MessageType::STREAM_DATA || n < static_cast<int>(PROTOCOL_HEADER_SIZE + WireCodec<StreamDataHeader>::SIZE)) {
+            logger.Log("Unexpected Message");
+            continue;
+        }
+        WireView<StreamDataHeader> view(buffer + PROTOCOL_HEADER_SIZE);
+        const StreamDataHeader d_header = view.Decode();
+        // Datagrams overtaken by later ones were counted as missed already
+        if (d_header.sequence < next_sequence) {
+            continue;
+        }
+        if (d_header.sequence > next_sequence) {
+            gaps.emplace_back(next_sequence, d_header.sequence - 1);
+            missed += d_header.sequence - next_sequence;
+        }
+        next_sequence = d_header.sequence + 1;
+        if (!streaming) {
+            streaming = true;
+            next_report = now + std::chrono::seconds(1);
+        }
+
+        const uint32_t count = std::min<uint32_t>(d_header.values, (n - PROTOCOL_HEADER_SIZE - WireCodec<StreamDataHeader>::SIZE) / sizeof(double));
+        for (uint32_t i = 0; i < count; ++i) {
+            double value;
+            Wire::Load(view.Payload() + i * sizeof(double), value);
+            std::string binary = std::bitset<sizeof(double) * 8>(value).to_string();
+            fout.write(binary.c_str(), binary.length());
+        }
+        values += count;
+
+        // Reports double as the keepalive of the session
+        if (now >= next_report) {
+            StreamReportHeader r_header;
+            r_header.client_id = client_id;
+            r_header.highest_sequence = next_sequence - 1;
+            r_header.missed = missed;
+            PrepareDataToSend(r_header, MessageType::STREAM_REPORT);
+            next_report = now + std::chrono::seconds(1);
+        }
+    }
+
+    // UNSUBSCRIBE is sent again for as long as the stream keeps coming
+    UnsubscribeHeader u_header;
+    u_header.client_id = client_id;
+    for (uint32_t i = 0; i < 5; ++i) {
+        PrepareDataToSend(u_header, MessageType::UNSUBSCRIBE);
+        // What was in flight when it left still arrives
+        DrainStream(100);
+        if (!DrainStream(300)) {
+            break;
+        }
+    }
+    AcknowledgeHeader a_header;
+    a_header.client_id = client_id;
+    PrepareDataToSend(a_header, MessageType::ACKNOWLEDGE);
+    fout.close();
+
+    WriteStreamGaps(gaps);
+    logger.Log("Stream ended: " + std::to_string(values) + " values in " + std::to_string(next_sequence - missed)
+               + " datagrams, " + std::to_string(missed) + " missed");
+    return true;
+}
+
+// Throws away what arrives for `ms` milliseconds; true if the stream was
+// still among it
+bool Client::DrainStream(const int& ms) {
+    bool streaming = false;
+    const auto end = std::chrono::system_clock::now() + std::chrono::milliseconds(ms);
+    auto now = std::chrono::system_clock::now();
+    while (now < end) {
+        if (Poll(std::max<int>(1, std::chrono::duration_cast<std::chrono::milliseconds>(end - now).count()))) {
+            int n = Receive();
+            if (n >= static_cast<int>(PROTOCOL_HEADER_SIZE)
+                && WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>() == MessageType::STREAM_DATA) {
+                streaming = true;
+            }
+        }
+        now = std::chrono::system_clock::now();
+    }
+    return streaming;
+}
+
+// Gap map of a subscription: every missing run of datagram sequence numbers
+void Client::WriteStreamGaps(const std::vector<std::pair<uint32_t, uint32_t>>& gaps) {
+    std::ofstream out("gaps");
+    for (const auto& gap : gaps) {
+        out << gap.first << " " << gap.second << "\n";
+    }
+}
+
+bool Client::RebuildFromSeed(const SeedResponseHeader& header) {
+    logger.Log(__func__);
+    if (header.generator_version != GENERATOR_VERSION) {
+        logger.Log("Server generator version " + std::to_string(header.generator_version) + " is not supported");
+        return false;
+    }
+    Generator generator(0);
+    if (!generator.GenerateStateless(arr, header.count, header.min, header.max, header.seed)) {
+        return false;
+    }
+    if (conf.server_sort) {
+        std::reverse(arr.begin(), arr.end());
+    }
+    return true;
+}
+
 bool Client::HandleError(const ErrorHeader& error) {
     bool can_continue;
     std::ostringstream oss;
@@ -322,6 +1128,16 @@ bool Client::HandleError(const ErrorHeader& error) {
             can_continue = true;
             break;
         }
+        case ErrorCode::INVALID_SESSION: {
+            oss << " Unknown session";
+            can_continue = false;
+            break;
+        }
+        case ErrorCode::SERVER_BUSY: {
+            oss << " Server has no free sessions";
+            can_continue = false;
+            break;
+        }
         default: {
             oss << "Unexpected error code";
             can_continue = false;
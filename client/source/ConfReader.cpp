@@ -3,10 +3,28 @@
 
 using json = nlohmann::json_abi_v3_11_3::json;
 
-ServerConfig::ServerConfig(const int& port, const std::string& ip, const double& val)
+ServerConfig::ServerConfig(const int& port, const std::string& ip, const double& val, const bool& seed, const bool& sort,
+                           const std::string& query_kind, const uint32_t& query_param, const bool& compress,
+                           const std::string& value_precision, const bool& fragment_checksums,
+                           const uint32_t& packet_size, const std::vector<double>& batch,
+                           const std::string& reliability_level, const uint32_t& deadline,
+                           const uint32_t& rate, const uint32_t& seconds)
     : server_port(port)
     , server_ip(ip)
-    , value(val) {}
+    , value(val)
+    , seed_only(seed)
+    , server_sort(sort)
+    , query(query_kind)
+    , query_parameter(query_param)
+    , compressed(compress)
+    , precision(value_precision)
+    , checksums(fragment_checksums)
+    , max_packet_size(packet_size)
+    , batch_values(batch)
+    , reliability(reliability_level)
+    , deadline_ms(deadline)
+    , subscribe_rate(rate)
+    , subscribe_seconds(seconds) {}
 
 ConfReader::ConfReader(const std::string& path = "./") : path_(path) {}
 
@@ -14,6 +32,18 @@ ServerConfig ConfReader::ReadServerConfig() {
     std::ifstream f(path_ + "clientconf.json");
     json data = json::parse(f);
     std::cout << "Port: " << data["port"] << "\n";
-    ServerConfig conf(data["port"], data["ip"], data["value"]);
+    ServerConfig conf(data["port"], data["ip"], data["value"], data.value("seed_only", false),
+                      data.value("server_sort", false),
+                      data.value("query", std::string()),
+                      data.value("query_parameter", 10u),
+                      data.value("compressed", false),
+                      data.value("precision", std::string("float64")),
+                      data.value("checksums", false),
+                      data.value("max_packet_size", 2048u),
+                      data.value("batch_values", std::vector<double>()),
+                      data.value("reliability", std::string("full")),
+                      data.value("deadline_ms", 1000u),
+                      data.value("subscribe_rate", 0u),
+                      data.value("subscribe_seconds", 5u));
     return conf;
 }
\ No newline at end of file
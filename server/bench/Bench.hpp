@@ -0,0 +1,38 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Wall-clock time of one call of `work`, in seconds
+template<class F>
+double TimeSeconds(F&& work) {
+    const auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sizes given on the command line, `defaults` if there are none
+inline std::vector<uint64_t> BenchSizes(int argc, char** argv, const std::vector<uint64_t>& defaults) {
+    std::vector<uint64_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    return sizes.empty() ? defaults : sizes;
+}
+
+// Keeps the compiler from dropping work whose result is otherwise unused
+template<class T>
+void KeepAlive(const T& value) {
+    #ifdef __GNUC__
+    asm volatile("" : : "g"(&value) : "memory");
+    #else
+    static const void* volatile sink;
+    sink = &value;
+    #endif
+}
+
+#endif // BENCH_HPP
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "ClientHandler.hpp"
+#include "Bench.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+// ns per AddClient, GetClient and RemoveClient with the table filled to
+// `sessions`, each session from an address of its own
+int main(int argc, char** argv) {
+    const std::vector<uint64_t> sizes = BenchSizes(argc, argv, {10000, 100000, 262144});
+    std::cout << std::setw(10) << "sessions" << std::setw(12) << "add ns" << std::setw(12) << "get ns"
+              << std::setw(12) << "remove ns" << "\n";
+    for (const uint64_t& sessions : sizes) {
+        ClientHandler handler(sessions);
+        std::vector<struct sockaddr_in> addresses(sessions);
+        std::vector<uint32_t> ids(sessions);
+        for (uint64_t i = 0; i < sessions; ++i) {
+            memset(&addresses[i], 0, sizeof(addresses[i]));
+            addresses[i].sin_family = AF_INET;
+            addresses[i].sin_addr.s_addr = htonl(0x0A000000 | static_cast<uint32_t>(i >> 8));
+            addresses[i].sin_port = htons(10000 + (i & 0xFF));
+        }
+
+        const double add = TimeSeconds([&]() {
+            for (uint64_t i = 0; i < sessions; ++i) {
+                ids[i] = handler.AddClient(addresses[i]);
+            }
+        });
+        // Lookups hold a guard per packet, as the dispatch thread does
+        uint64_t found = 0;
+        const double get = TimeSeconds([&]() {
+            for (uint64_t i = 0; i < sessions; ++i) {
+                EpochGuard guard(handler.GetEpoch());
+                found += handler.GetClient(ids[i], addresses[i]) != nullptr;
+            }
+        });
+        KeepAlive(found);
+        const double remove = TimeSeconds([&]() {
+            for (uint64_t i = 0; i < sessions; ++i) {
+                handler.RemoveClient(ids[i], addresses[i]);
+            }
+        });
+        if (found != sessions) {
+            std::cerr << "lookups missed " << sessions - found << " sessions\n";
+            return 1;
+        }
+        std::cout << std::setw(10) << sessions << std::fixed << std::setprecision(1)
+                  << std::setw(12) << add * 1e9 / sessions << std::setw(12) << get * 1e9 / sessions
+                  << std::setw(12) << remove * 1e9 / sessions << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "Crc32c.hpp"
+#include "Bench.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+// Cost per byte of the selected CRC-32C kernel and of the slicing-by-8
+// tables, over buffers from a control message up to a large fragment
+int main(int argc, char** argv) {
+    const std::vector<uint64_t> sizes = BenchSizes(argc, argv, {16, 64, 256, 1024, 2040, 8184, 65480});
+    constexpr uint64_t TOTAL_BYTES = 1ULL << 30;
+    std::cout << "Selected kernel: " << Crc32c::KernelName() << "\n";
+    std::cout << std::setw(10) << "bytes" << std::setw(16) << "selected ns/B" << std::setw(16) << "portable ns/B"
+              << std::setw(12) << "GB/s" << "\n";
+    for (const uint64_t& size : sizes) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(i * 131 + 7);
+        }
+        const uint64_t rounds = std::max<uint64_t>(1, TOTAL_BYTES / size);
+        uint32_t crc = 0;
+        const double selected = TimeSeconds([&]() {
+            for (uint64_t i = 0; i < rounds; ++i) {
+                crc = Crc32c::Extend(crc, data.data(), size);
+            }
+        });
+        const double portable = TimeSeconds([&]() {
+            for (uint64_t i = 0; i < rounds; ++i) {
+                crc = Crc32c::ExtendPortable(crc, data.data(), size);
+            }
+        });
+        KeepAlive(crc);
+        const double bytes = static_cast<double>(rounds) * size;
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(3) << std::setw(16) << selected * 1e9 / bytes
+                  << std::setw(16) << portable * 1e9 / bytes << std::setprecision(2) << std::setw(12) << bytes / selected / 1e9
+                  << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
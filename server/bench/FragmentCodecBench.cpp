@@ -0,0 +1,61 @@
+#include "FragmentCodec.hpp"
+#include "Generator.hpp"
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// Size ratio and per-core encode and decode speed of FragmentCodec on a
+// stratified response for 1e9, cut into default-size fragments
+int main(int argc, char** argv) {
+    const std::vector<uint64_t> sizes = BenchSizes(argc, argv, {1000000, 10000000});
+    const uint32_t fragment_values = (DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE) / sizeof(double);
+    std::cout << std::setw(12) << "values" << std::setw(11) << "fragments" << std::setw(6) << "raw" << std::setw(8) << "ratio"
+              << std::setw(14) << "encode MB/s" << std::setw(14) << "decode MB/s" << "\n";
+    Generator generator(1);
+    for (const uint64_t& count : sizes) {
+        std::vector<double> values;
+        if (!generator.GenerateStateless(values, count, -1e9, 1e9, 5)) {
+            std::cerr << "GenerateStateless failed for " << count << " values\n";
+            return 1;
+        }
+        const uint32_t fragments = (count + fragment_values - 1) / fragment_values;
+        std::vector<char> encoded(count * sizeof(double));
+        std::vector<uint32_t> encoded_sizes(fragments);
+        std::vector<FragmentEncoding> encodings(fragments);
+        const double encode = TimeSeconds([&]() {
+            for (uint32_t i = 0; i < fragments; ++i) {
+                const uint64_t first = static_cast<uint64_t>(i) * fragment_values;
+                const uint32_t size = std::min<uint64_t>(fragment_values, count - first);
+                encoded_sizes[i] = FragmentCodec::Encode(values.data() + first, size, encoded.data() + first * sizeof(double),
+                                                         encodings[i]);
+            }
+        });
+        std::vector<double> decoded(count);
+        uint64_t decoded_values = 0;
+        const double decode = TimeSeconds([&]() {
+            for (uint32_t i = 0; i < fragments; ++i) {
+                const uint64_t first = static_cast<uint64_t>(i) * fragment_values;
+                decoded_values += FragmentCodec::Decode(encodings[i], encoded.data() + first * sizeof(double), encoded_sizes[i],
+                                                        decoded.data() + first, fragment_values, 1.0);
+            }
+        });
+        if (decoded_values != count || decoded != values) {
+            std::cerr << "Round trip failed for " << count << " values\n";
+            return 1;
+        }
+
+        uint64_t encoded_bytes = 0;
+        uint32_t raw = 0;
+        for (uint32_t i = 0; i < fragments; ++i) {
+            encoded_bytes += encoded_sizes[i];
+            raw += encodings[i] == FragmentEncoding::RAW;
+        }
+        const double bytes = count * sizeof(double);
+        std::cout << std::setw(12) << count << std::setw(11) << fragments << std::setw(6) << raw << std::fixed
+                  << std::setprecision(2) << std::setw(8) << bytes / encoded_bytes << std::setprecision(0)
+                  << std::setw(14) << bytes / encode / 1e6 << std::setw(14) << bytes / decode / 1e6 << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "Generator.hpp"
+#include "Bench.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+// What the server did before GenerateUnique: draw until a hash set holds
+// `count` distinct values, then copy them out unordered
+std::vector<double> HashSetLoop(const uint32_t& count, const double& min, const double& max) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dis(min, max);
+    std::unordered_set<double> unique_set;
+    while (unique_set.size() < static_cast<size_t>(count)) {
+        unique_set.insert(dis(gen));
+    }
+    return std::vector<double>(unique_set.begin(), unique_set.end());
+}
+
+// Rough peak of HashSetLoop: a node and a bucket per value plus the copy
+constexpr uint64_t HASH_SET_BYTES_PER_VALUE = 56;
+
+uint64_t PhysicalMemory() {
+    #ifdef _WIN32
+    return ~0ULL;
+    #else
+    return static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+    #endif
+}
+}
+
+// Millions of values per second for GenerateUnique against the hash set
+// loop, with the range of a REQUEST for 1e9
+int main(int argc, char** argv) {
+    const std::vector<uint64_t> sizes = BenchSizes(argc, argv, {1000000, 10000000, 100000000});
+    const double min = -1e9;
+    const double max = 1e9;
+    std::cout << std::setw(12) << "values" << std::setw(16) << "unique M/s" << std::setw(16) << "hash set M/s"
+              << std::setw(10) << "speedup" << "\n";
+    Generator generator(1);
+    for (const uint64_t& count : sizes) {
+        std::vector<double> values;
+        bool ok = true;
+        const double unique = TimeSeconds([&]() { ok = generator.GenerateUnique(values, count, min, max); });
+        if (!ok) {
+            std::cerr << "GenerateUnique failed for " << count << " values\n";
+            return 1;
+        }
+        KeepAlive(values);
+        values = std::vector<double>();
+
+        std::cout << std::setw(12) << count << std::fixed << std::setprecision(1) << std::setw(16) << count / unique / 1e6;
+        if (count * HASH_SET_BYTES_PER_VALUE > PhysicalMemory() / 2) {
+            std::cout << std::setw(16) << "skipped" << "  (needs ~" << count * HASH_SET_BYTES_PER_VALUE / (1 << 20) << " MB)\n";
+            continue;
+        }
+        const double hash_set = TimeSeconds([&]() { values = HashSetLoop(count, min, max); });
+        KeepAlive(values);
+        std::cout << std::setw(16) << count / hash_set / 1e6 << std::setw(9) << hash_set / unique << "x\n";
+    }
+    return 0;
+}
\ No newline at end of file
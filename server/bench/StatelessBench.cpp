@@ -0,0 +1,90 @@
+#include "ClientHandler.hpp"
+#include "Generator.hpp"
+#include "Precision.hpp"
+#include "Bench.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// Memory a set of concurrent sessions holds for their responses, stored
+// against stateless, and how fast each serves retransmitted fragments
+// picked at random across the sessions: a copy out of the stored values
+// against Regenerate.
+// Usage: StatelessBench [sessions] [values per session]
+int main(int argc, char** argv) {
+    const uint32_t sessions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const uint32_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+    constexpr uint32_t RETRANSMITS = 1000000;
+    const uint32_t packet_values = (DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE) / sizeof(double);
+    const uint32_t packets = (count + packet_values - 1) / packet_values;
+
+    Generator generator(1);
+    std::vector<Dataset> stateless(sessions);
+    std::vector<Dataset> stored(sessions);
+    bool ok = true;
+    const double build_stateless = TimeSeconds([&]() {
+        for (Dataset& dataset : stateless) {
+            dataset.seed = generator.NextSeed();
+            dataset.count = count;
+            dataset.min = -1e9;
+            dataset.max = 1e9;
+        }
+    });
+    const double build_stored = TimeSeconds([&]() {
+        for (uint32_t i = 0; i < sessions; ++i) {
+            stored[i] = stateless[i];
+            std::vector<double> values;
+            ok = ok && generator.GenerateStateless(values, count, stored[i].min, stored[i].max, stored[i].seed);
+            stored[i].data = Buffer::Adopt(std::move(values));
+        }
+    });
+    if (!ok) {
+        std::cerr << "GenerateStateless failed\n";
+        return 1;
+    }
+    size_t stored_bytes = 0;
+    for (const Dataset& dataset : stored) {
+        stored_bytes += sizeof(Dataset) + dataset.data.Size();
+    }
+    const size_t stateless_bytes = sessions * sizeof(Dataset);
+
+    std::mt19937_64 random(7);
+    std::vector<std::pair<uint32_t, uint32_t>> requests(RETRANSMITS);
+    for (auto& request : requests) {
+        request = {static_cast<uint32_t>(random() % sessions), static_cast<uint32_t>(random() % packets)};
+    }
+    std::vector<double> fragment(packet_values);
+    size_t bytes = 0;
+    const double copy = TimeSeconds([&]() {
+        for (const auto& request : requests) {
+            const Dataset& dataset = stored[request.first];
+            const uint32_t first = request.second * packet_values;
+            const uint32_t size = std::min(packet_values, count - first);
+            memcpy(fragment.data(), dataset.data.As<double>() + first, size * sizeof(double));
+            bytes += size * sizeof(double);
+        }
+    });
+    KeepAlive(fragment);
+    const double regenerate = TimeSeconds([&]() {
+        for (const auto& request : requests) {
+            const Dataset& dataset = stateless[request.first];
+            const uint32_t first = request.second * packet_values;
+            const uint32_t size = std::min(packet_values, count - first);
+            Precision::Regenerate(dataset.precision, dataset.descending, fragment.data(), first, size, dataset.count,
+                                  dataset.min, dataset.max, dataset.seed);
+        }
+    });
+    KeepAlive(fragment);
+
+    std::cout << sessions << " sessions of " << count << " values, " << RETRANSMITS << " random fragments of "
+              << packet_values << " values\n" << std::fixed << std::setprecision(1);
+    std::cout << std::setw(10) << "" << std::setw(14) << "held MB" << std::setw(14) << "bytes/session"
+              << std::setw(12) << "setup s" << std::setw(16) << "fragments/s" << std::setw(10) << "MB/s" << "\n";
+    std::cout << std::setw(10) << "stored" << std::setw(14) << stored_bytes / 1e6 << std::setw(14) << stored_bytes / sessions
+              << std::setw(12) << build_stored << std::setw(16) << RETRANSMITS / copy << std::setw(10) << bytes / copy / 1e6 << "\n";
+    std::cout << std::setw(10) << "stateless" << std::setw(14) << stateless_bytes / 1e6 << std::setw(14) << stateless_bytes / sessions
+              << std::setw(12) << build_stateless << std::setw(16) << RETRANSMITS / regenerate << std::setw(10)
+              << bytes / regenerate / 1e6 << "\n";
+    return 0;
+}
\ No newline at end of file
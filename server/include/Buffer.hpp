@@ -0,0 +1,46 @@
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Immutable, reference-counted byte buffer.
+// Copies and slices share one allocation, which is released when the last
+// of them goes away. Anything queued for sending holds a Buffer, so payloads
+// stay valid for the sender and the retransmit path without copies or
+// ownership flags.
+class Buffer {
+public:
+    Buffer();
+
+    static Buffer Copy(const void* data, const size_t& size);
+    // Memory kept alive by `owner`, e.g. a pooled block returned by its deleter
+    static Buffer Share(std::shared_ptr<const void> owner, const void* data, const size_t& size);
+    template<class T>
+    static Buffer Adopt(std::vector<T>&& values);
+
+    Buffer Slice(const size_t& offset, const size_t& size) const;
+    const char* Data() const;
+    size_t Size() const;
+    bool Empty() const;
+
+    template<class T>
+    const T* As() const { return reinterpret_cast<const T*>(data_); }
+
+private:
+    Buffer(std::shared_ptr<const void> owner, const char* data, const size_t& size);
+
+    std::shared_ptr<const void> owner_;
+    const char* data_;
+    size_t size_;
+};
+
+template<class T>
+Buffer Buffer::Adopt(std::vector<T>&& values) {
+    auto owner = std::make_shared<const std::vector<T>>(std::move(values));
+    return Buffer(owner, reinterpret_cast<const char*>(owner->data()), owner->size() * sizeof(T));
+}
+
+#endif // BUFFER_HPP
\ No newline at end of file
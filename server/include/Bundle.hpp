@@ -0,0 +1,112 @@
+#ifndef BUNDLE_HPP
+#define BUNDLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Protocol.hpp"
+#include "WireCodec.hpp"
+
+// A BUNDLE datagram carries several messages for the same peer. Its payload
+// is the messages back to back, each a ProtocolHeader with packet_number and
+// packets_total 1 and a data_size that is the exact length of the payload
+// following it. Bundles hold single-datagram messages only: no RESPONSE
+// fragments and no nested bundles. Bundles the server sends fit the packet
+// size the session agreed on; those it receives fit DEFAULT_PACKET_SIZE.
+class BundleWriter {
+public:
+    // `out` must hold `capacity` bytes, the whole datagram
+    BundleWriter(char* out, const size_t& capacity) : out_(out), capacity_(capacity), size_(PROTOCOL_HEADER_SIZE), count_(0) {}
+
+    // Whether a message with `size` payload bytes still fits
+    bool Fits(const size_t& size) const {
+        return size_ + PROTOCOL_HEADER_SIZE + size <= capacity_;
+    }
+
+    bool Append(const MessageType& type, const char* data, const size_t& size) {
+        if (!Fits(size) || type == MessageType::BUNDLE || type == MessageType::RESPONSE) {
+            return false;
+        }
+        WireCodec<ProtocolHeader>::Encode(Header(type, size), out_ + size_);
+        memcpy(out_ + size_ + PROTOCOL_HEADER_SIZE, data, size);
+        size_ += PROTOCOL_HEADER_SIZE + size;
+        ++count_;
+        return true;
+    }
+
+    // Writes the bundle's own header; returns the datagram size
+    size_t Finish() {
+        WireCodec<ProtocolHeader>::Encode(Header(MessageType::BUNDLE, size_ - PROTOCOL_HEADER_SIZE), out_);
+        return size_;
+    }
+
+    size_t Count() const {
+        return count_;
+    }
+
+    static ProtocolHeader Header(const MessageType& type, const size_t& size) {
+        ProtocolHeader header;
+        header.packet_number = 1;
+        header.packets_total = 1;
+        header.data_size = static_cast<uint16_t>(size);
+        header.type = type;
+        header.encoding = FragmentEncoding::RAW;
+        return header;
+    }
+
+private:
+    char* out_;
+    size_t capacity_;
+    size_t size_;
+    size_t count_;
+};
+
+// Walks the messages of a BUNDLE datagram. Each message comes with its own
+// ProtocolHeader, so handlers take it like a datagram of their own. A nested
+// BUNDLE or a RESPONSE fragment makes the rest of the bundle malformed
+class BundleReader {
+public:
+    BundleReader(const char* datagram, const size_t& size)
+        : data_(datagram), size_(size), offset_(PROTOCOL_HEADER_SIZE), malformed_(false) {
+        if (size_ < PROTOCOL_HEADER_SIZE) {
+            offset_ = size_;
+            malformed_ = true;
+        }
+    }
+
+    // Finds the next message at datagram + `message_offset`. False once the
+    // bundle is exhausted or the next message is malformed
+    bool Next(size_t& message_offset, size_t& message_size) {
+        if (malformed_ || offset_ == size_) {
+            return false;
+        }
+        if (size_ - offset_ < PROTOCOL_HEADER_SIZE) {
+            malformed_ = true;
+            return false;
+        }
+        WireView<ProtocolHeader> view(data_ + offset_);
+        const size_t data_size = view.Get<&ProtocolHeader::data_size>();
+        const MessageType type = view.Get<&ProtocolHeader::type>();
+        if (size_ - offset_ - PROTOCOL_HEADER_SIZE < data_size || type == MessageType::BUNDLE || type == MessageType::RESPONSE) {
+            malformed_ = true;
+            return false;
+        }
+        message_offset = offset_;
+        message_size = PROTOCOL_HEADER_SIZE + data_size;
+        offset_ += message_size;
+        return true;
+    }
+
+    bool Malformed() const {
+        return malformed_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_;
+    bool malformed_;
+};
+
+#endif // BUNDLE_HPP
\ No newline at end of file
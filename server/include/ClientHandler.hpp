@@ -3,9 +3,12 @@
 
 #include <iostream>
 #include <thread>
-#include <deque>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -16,28 +19,144 @@
 #include <sys/socket.h>
 #endif
 
+#include "Buffer.hpp"
+#include "Epoch.hpp"
+#include "TimerWheel.hpp"
+#include "Protocol.hpp"
+#include "FragmentCodec.hpp"
+
+constexpr uint32_t INVALID_CLIENT_ID = 0xFFFFFFFF;
+
+// Generated response retained by a session for retransmission. Stored
+// datasets keep the values in a shared Buffer, so queued sends keep them
+// alive on their own. Stateless datasets leave `data` empty and rebuild any
+// fragment from the seed, range and count instead. Descending datasets hold
+// (or regenerate) the values in reverse order. Compressed datasets encode
+// every fragment they send, retransmissions included. Reduced-precision
+// datasets hold (or regenerate) 4-byte items, so their fragments carry
+// twice as many values. Checksummed datasets keep the digest of the whole
+// response for resends of the final fragment; streamed ones only know it
+// once the last chunk is generated, and the dispatch thread records it then.
+// Fragments hold the payload size the session agreed on at CONNECT.
+// A batch holds one dataset per requested value in `parts` and no values of
+// its own; its fragments are those of the parts, one part after another.
+// Flow controlled datasets keep their values in `chunks` instead of `data`,
+// WINDOW_CHUNK_PACKETS fragments each, and drop those the client acknowledged.
+struct Dataset {
+    Buffer data;
+    uint64_t seed = 0;
+    uint32_t count = 0;
+    double min = 0;
+    double max = 0;
+    bool descending = false;
+    bool compressed = false;
+    ValuePrecision precision = ValuePrecision::FLOAT64;
+    bool checksums = false;
+    bool digest_ready = false;
+    uint32_t digest = 0;
+    uint32_t packet_data_size = DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE;
+    std::vector<Dataset> parts;
+    std::vector<Buffer> chunks;
+
+    // Fragments of the whole response
+    uint32_t Packets() const {
+        if (!parts.empty()) {
+            return parts.size() * parts[0].Packets();
+        }
+        return (static_cast<uint64_t>(count) * FragmentCodec::ValueSize(precision) + packet_data_size - 1) / packet_data_size;
+    }
+};
+
 struct Client {
     uint32_t id;
     struct sockaddr_in client_addr;
-    std::vector<double> data;
-    uint32_t data_size; 
-    uint16_t* missed_packets;
+    std::atomic<Dataset*> dataset;
+    // Agreed at CONNECT
+    uint32_t capabilities;
+    uint32_t packet_data_size;
+
+    // Owned by the dispatch thread
+    std::chrono::steady_clock::time_point last_activity;
+    TimerId idle_timer;
+    TimerId retention_timer;
+    TimerId retransmit_timer;
+    std::chrono::steady_clock::time_point response_sent_at;
+    uint32_t probes_sent;
+    bool retransmitted;
+    // Bumped by every response, so that completions the sender posts for an
+    // earlier one are told apart
+    uint32_t transfer;
+    // Flow control: the client takes fragments up to received_through +
+    // receive_window; next_fragment is the first one not sent yet
+    uint32_t receive_window;
+    uint32_t received_through;
+    uint32_t next_fragment;
+    // Subscription, while subscription_rate is not 0: values come from the
+    // counter-based stream of stream_seed, stream_values of them so far
+    uint32_t subscription_rate;
+    uint64_t stream_seed;
+    uint64_t stream_values;
+    uint32_t stream_sequence;
+    double stream_min;
+    double stream_max;
+    std::chrono::steady_clock::time_point stream_started;
+    TimerId stream_timer;
 };
 
+// Session table keyed by (client address, session id).
+// Lookups go through an open-addressing hash table with linear probing, so a
+// session id is only accepted from the address that created it. Free ids are
+// tracked in a bitmap; the id doubles as the index into clients_.
+//
+// Reads are lock-free: GetClient() and the returned Client (including its
+// dataset) stay valid for as long as the caller holds an EpochGuard on
+// GetEpoch(). Writers serialize on a mutex and retire removed sessions and
+// replaced datasets through the epoch manager, so a session id is not reused
+// and a dataset is not freed while any reader may still see it.
 class ClientHandler {
 public:
     ClientHandler() {}
     ClientHandler(const uint32_t& max_clients);
+    ClientHandler(const ClientHandler&) = delete;
+    bool Initialize(const uint32_t& max_clients);
     uint32_t AddClient(const struct sockaddr_in& client_addr);
-    
-    bool RemoveClient(const uint32_t& client_id);
-    Client& GetClient(const uint32_t& client_id);
-    std::vector<Client> clients_;
+
+    bool RemoveClient(const uint32_t& client_id, const struct sockaddr_in& client_addr);
+    Client* GetClient(const uint32_t& client_id, const struct sockaddr_in& client_addr);
+    Client* GetClient(const uint32_t& client_id);
+    void SetDataset(Client& client, Dataset* dataset);
+    EpochManager& GetEpoch();
+    uint32_t Size();
+    ~ClientHandler();
 private:
-    std::mutex mx_deque_clients_;
-    std::mutex mx_deque_ids_;
-    std::deque<uint32_t> available_client_ids_;
-    uint32_t last_client_id_;
+    // Slots hold id + 1 so that zero-initialized memory reads as empty
+    static constexpr uint32_t EMPTY_SLOT = 0;
+    static constexpr uint32_t DELETED_SLOT = 0xFFFFFFFF;
+
+    struct Table {
+        uint32_t mask;
+        std::unique_ptr<std::atomic<uint32_t>[]> slots;
+    };
+
+    static uint64_t Hash(const uint32_t& addr, const uint16_t& port, const uint32_t& id);
+    static Table* CreateTable(const uint32_t& capacity);
+    static void Insert(Table& table, const uint32_t& home, const uint32_t& id);
+    uint32_t FindSlot(const Table& table, const uint32_t& addr, const uint16_t& port, const uint32_t& id);
+    uint32_t HomeSlot(const Table& table, const uint32_t& id);
+    Table* Rebuild();
+    void RetireTable(Table* table);
+    uint32_t AllocateId();
+    void ReleaseId(const uint32_t& id);
+
+    std::unique_ptr<Client[]> clients_;
+    uint32_t max_clients_ = 0;
+    std::atomic<Table*> table_{nullptr};
+    std::vector<uint64_t> id_bitmap_;
+    uint32_t id_hint_ = 0;
+    uint32_t tombstones_ = 0;
+    std::atomic<uint32_t> size_{0};
+    std::mutex mx_clients_;
+    EpochManager epoch_;
 };
 
 #endif // CLIENT_HANDLER_HPP
\ No newline at end of file
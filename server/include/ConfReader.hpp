@@ -2,12 +2,32 @@
 #define CONF_READER_HPP
 
 #include <fstream>
+#include <vector>
 #include "json.hpp"
 
+// Defaults apply to keys missing from serverconf.json; only the port is required
 struct ServerConfig {
-    ServerConfig() {}
-    ServerConfig(const int& port);
-    int server_port;
+    int server_port = 0;
+    uint32_t max_clients = 256;
+    uint32_t session_idle_timeout_ms = 30000;
+    uint32_t response_retention_ms = 60000;
+    bool stateless_datasets = false;
+    bool seed_responses = true;
+    std::vector<double> pool_values;
+    uint32_t pool_depth = 2;
+    uint32_t pool_memory_limit_mb = 256;
+    bool streaming_responses = false;
+    bool compressed_responses = false;
+    bool reduced_precision = false;
+    bool response_checksums = false;
+    uint32_t max_packet_size = 2048;
+    bool bundled_messages = false;
+    uint32_t bundle_delay_us = 0;
+    bool batch_requests = false;
+    bool flow_control = false;
+    bool best_effort_transfers = false;
+    bool subscriptions = false;
+    uint32_t max_subscription_rate = 1000000;
 };
 
 struct ProtocolConfig {
@@ -1,7 +1,34 @@
 #ifndef CONSTANTS_HPP
 #define CONSTANTS_HPP
 
+#include <cstdint>
+
 constexpr uint32_t BUFFER_SIZE = 2048;
 constexpr uint32_t MAX_PACKET_SIZE = 2048;
+constexpr uint32_t SEND_BATCH_SIZE = 64;
+
+// Retransmission timing, see RttEstimator
+constexpr uint32_t INITIAL_RTO_MS = 1000;
+constexpr uint32_t MIN_RTO_MS = 200;
+constexpr uint32_t MAX_RTO_MS = 10000;
+constexpr uint32_t MIN_PROBE_TIMEOUT_MS = 10;
+constexpr uint32_t MAX_RETRANSMIT_PROBES = 6;
+constexpr uint32_t TAIL_PROBE_PACKETS = 2;
+
+// Streamed responses, see ResponseStreamer
+constexpr uint32_t STREAM_CHUNK_PACKETS = 256;
+constexpr uint32_t STREAM_RING_CHUNKS = 8;
+
+// Flow controlled transfers hold their values in separate chunks of this
+// many fragments, see Server::HoldInChunks
+constexpr uint32_t WINDOW_CHUNK_PACKETS = 256;
+
+// Subscriptions: each one is served every STREAM_TICK_MS, or less often when
+// its rate fills a datagram more slowly, up to STREAM_MAX_TICK_MS. A server
+// that falls behind sends at most STREAM_MAX_BURST datagrams per tick and
+// skips the rest
+constexpr uint32_t STREAM_TICK_MS = 10;
+constexpr uint32_t STREAM_MAX_TICK_MS = 100;
+constexpr uint32_t STREAM_MAX_BURST = 64;
 
 #endif // CONSTANTS_HPP
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef DATASET_POOL_HPP
+#define DATASET_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Buffer.hpp"
+#include "Generator.hpp"
+
+// Ready-made datasets for the configured value count and a fixed set of
+// request values, kept topped up by a background producer thread with its
+// own Generator. A request whose value has a ready dataset starts sending
+// without generating anything on the dispatch thread. The pool holds at most
+// `depth` datasets per value and never more than `memory_limit` bytes.
+class DatasetPool {
+public:
+    struct Entry {
+        uint64_t seed;
+        Buffer data;
+        bool stateless;
+    };
+
+    DatasetPool();
+    DatasetPool(const DatasetPool&) = delete;
+    ~DatasetPool();
+
+    void Start(const uint32_t& count, const std::vector<double>& values, const uint32_t& depth,
+               const size_t& memory_limit, const bool& stateless);
+    bool Take(const double& value, Entry& entry);
+    // A ready dataset shared with the pool, which keeps it for a REQUEST to
+    // take; for readers that never hand the data to a session
+    bool Borrow(const double& value, Entry& entry);
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+
+private:
+    struct Slot {
+        double value;
+        std::deque<Entry> ready;
+        bool disabled;
+    };
+
+    void Produce();
+    Slot* NextToFill();
+
+    std::vector<Slot> slots_;
+    uint32_t count_ = 0;
+    uint32_t depth_ = 0;
+    size_t memory_limit_ = 0;
+    size_t memory_used_ = 0;
+    bool stateless_ = false;
+    bool stop_ = false;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    Generator generator_;
+    std::mutex mx_pool_;
+    std::condition_variable cv_pool_;
+    std::thread producer_;
+};
+
+#endif // DATASET_POOL_HPP
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Epoch-based reclamation for read-mostly shared structures.
+// Readers wrap every access in an EpochGuard; writers unlink an object and
+// hand its deleter to Retire(). The deleter runs once the global epoch has
+// moved twice past the retirement point, i.e. after every reader that could
+// still see the object has left its critical section.
+class EpochManager {
+public:
+    EpochManager();
+    EpochManager(const EpochManager&) = delete;
+    ~EpochManager();
+
+    void Enter();
+    void Exit();
+    void Retire(std::function<void()> deleter);
+    void Collect();
+
+private:
+    static constexpr uint32_t MAX_PARTICIPANTS = 64;
+    static constexpr uint64_t QUIESCENT = ~0ULL;
+
+    struct alignas(64) Participant {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> in_use;
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    // A thread's participant in one manager. Managers are told apart by id
+    // as well, since a new one can take the address of a destroyed one
+    struct LocalSlot {
+        const EpochManager* owner;
+        uint64_t owner_id;
+        Participant* participant;
+        uint32_t depth;
+    };
+
+    // The slots of one thread, released when it exits
+    class ThreadSlots;
+
+    LocalSlot& Local();
+    bool TryAdvance();
+
+    const uint64_t id_;
+    Participant participants_[MAX_PARTICIPANTS];
+    std::atomic<uint64_t> global_epoch_;
+    std::mutex mx_retired_;
+    std::deque<Retired> retired_;
+};
+
+class EpochGuard {
+public:
+    explicit EpochGuard(EpochManager& epoch) : epoch_(epoch) { epoch_.Enter(); }
+    EpochGuard(const EpochGuard&) = delete;
+    ~EpochGuard() { epoch_.Exit(); }
+private:
+    EpochManager& epoch_;
+};
+
+#endif // EPOCH_HPP
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef FRAGMENT_CODEC_HPP
+#define FRAGMENT_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Protocol.hpp"
+
+// Compact encoding for the doubles of one RESPONSE fragment.
+// Every fragment is encoded on its own, so it decodes without any other
+// fragment and retransmissions need no extra state. Doubles are mapped to
+// integer keys that sort in the same order as the values; a monotone run of
+// values then becomes a first key plus small non-negative deltas, which are
+// bit-packed at the width of the largest one. Responses are always sorted,
+// so the deltas are about the stratum width in units of the last place,
+// typically 30-40 bits instead of 64. Fragments that are not monotone, or
+// would not get smaller, are sent raw.
+//
+// DELTA layout, little-endian bit stream:
+//   count (16) | width (8) | direction (8) | first key (64) | count - 1 deltas (width each)
+//
+// Reduced-precision responses carry FLOAT32 or FIXED32 items instead, four
+// bytes each, which Decode widens back to doubles.
+class FragmentCodec {
+public:
+    static constexpr uint32_t MAX_DELTA_WIDTH = 56;
+
+    // `out` must hold count * sizeof(double) bytes; returns the bytes written
+    static uint32_t Encode(const double* values, const uint32_t& count, char* out, FragmentEncoding& encoding);
+    // Returns the number of values written to `out`, 0 for a malformed payload.
+    // `fixed_scale` is FixedScale of the requested range, used by FIXED32
+    static uint32_t Decode(const FragmentEncoding& encoding, const char* data, const uint32_t& size, double* out,
+                           const uint32_t& capacity, const double& fixed_scale);
+
+    static uint32_t ValueSize(const FragmentEncoding& encoding);
+    static uint32_t ValueSize(const ValuePrecision& precision);
+    // Step of FIXED32 values for a range of [-range, range]: the smallest
+    // power of two that keeps range / step within 2^31
+    static double FixedScale(const double& range);
+
+private:
+    static uint64_t Key(const double& value);
+    static double Value(const uint64_t& key);
+};
+
+#endif // FRAGMENT_CODEC_HPP
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Random.hpp"
+
+// Produces datasets of distinct doubles for RESPONSE payloads.
+// Uniqueness comes from the layout instead of a hash set: the range is cut
+// into `count` equal strata and one value is drawn inside each, which gives
+// strictly increasing output in a single pass over a flat array. Each value
+// is confined to its own stratum, so any slice can be produced on its own.
+// Ranges too narrow for that (strata below the double spacing) fall back to
+// drawing, sorting and de-duplicating in place until enough values are
+// distinct.
+//
+// Strata are generated in fixed blocks, each with its own random stream
+// derived from (request seed, block index). Large datasets spread the blocks
+// over all cores; because the split never depends on the thread count, the
+// output for a given seed is the same however many threads produced it.
+// Request seeds come from a per-instance stream that is seeded once, so use
+// one Generator per worker thread.
+//
+// Stateless datasets use the counter-based stream instead, so any range of
+// values can be rebuilt later from (seed, count, min, max) alone. They have
+// no sort fallback; GenerateStateless fails when the range is too narrow.
+// Bumped whenever the values produced for a given seed change; clients that
+// rebuild seed-only responses must run the same version
+constexpr uint32_t GENERATOR_VERSION = 2;
+
+class Generator {
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+    static constexpr size_t PARALLEL_THRESHOLD = 1 << 20;
+
+    Generator();
+    explicit Generator(const uint64_t& seed);
+
+    bool GenerateUnique(std::vector<double>& out, const uint32_t& count, const double& min, const double& max);
+    bool GenerateUnique(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                        const uint64_t& seed);
+    bool GenerateStateless(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                           const uint64_t& seed);
+    static void Regenerate(double* out, const uint32_t& first, const uint32_t& size, const uint32_t& count,
+                           const double& min, const double& max, const uint64_t& seed);
+    // Values at positions [first, first + size) of the descending order
+    static void RegenerateDescending(double* out, const uint32_t& first, const uint32_t& size, const uint32_t& count,
+                                     const double& min, const double& max, const uint64_t& seed);
+    static bool Stratifiable(const uint32_t& count, const double& min, const double& max);
+    uint64_t NextSeed();
+
+private:
+    bool Stratified(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                    const uint64_t& seed, const bool& counter_based);
+    bool StratifiedBlocks(double* out, const uint32_t& count, const size_t& first_block, const size_t& last_block,
+                          const double& min, const double& max, const uint64_t& seed, const bool& counter_based);
+    static void Confine(double* out, const size_t& first, const size_t& size, const double& min, const double& width,
+                        const double& last);
+    bool SortDedupe(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                    const uint64_t& seed);
+
+    uint64_t seed_state_;
+};
+
+#endif // GENERATOR_HPP
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef PRECISION_HPP
+#define PRECISION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Protocol.hpp"
+
+// Converts generated datasets to the reduced precisions a REQUEST can ask
+// for (float32, or 32-bit fixed point in steps of FragmentCodec::FixedScale).
+// Values are stratified, value i lying in [min + i * width, min + (i + 1) * width).
+// Each value is rounded down to the target grid and then raised to the
+// first grid point of its own stratum if rounding left it, so it never leaves
+// the stratum; as long as every stratum holds a grid point the narrowed
+// values stay distinct and ascending. The result depends on nothing but the
+// value and its index, so any slice converts on its own, like Regenerate.
+// Kernels use directed rounding and exact integer steps, so the scalar, AVX2
+// and AVX-512 variants agree bit for bit.
+class Precision {
+public:
+    // Whether `count` values in [min, max) keep distinct at `precision`
+    static bool Representable(const ValuePrecision& precision, const uint32_t& count, const double& min, const double& max);
+    // Narrows ascending values at stratum indices [first, first + size) into
+    // 4-byte items; `out` may alias `values`
+    static void Narrow(const ValuePrecision& precision, const double* values, const uint32_t& first, const uint32_t& size,
+                       const uint32_t& count, const double& min, const double& max, void* out);
+    // Payload for positions [first, first + size) of a counter-based dataset
+    // in the requested order and precision. `out` must hold `size` doubles;
+    // returns the bytes written
+    static size_t Regenerate(const ValuePrecision& precision, const bool& descending, void* out, const uint32_t& first,
+                             const uint32_t& size, const uint32_t& count, const double& min, const double& max,
+                             const uint64_t& seed);
+    static void Reverse(const ValuePrecision& precision, void* values, const size_t& size);
+
+    static const char* KernelName();
+};
+
+#endif // PRECISION_HPP
\ No newline at end of file
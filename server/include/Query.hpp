@@ -0,0 +1,26 @@
+#ifndef QUERY_HPP
+#define QUERY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reductions run on the server for QUERY requests, so a client that only
+// needs a summary receives a few bytes instead of the whole dataset.
+// Inputs are datasets as the Generator produces them, strictly ascending;
+// min, max, top-K, quantiles and histogram bin edges are therefore positional
+// lookups, and only the sum needs a pass over the data. That pass keeps eight
+// fixed partial sums, so the SSE2, AVX2 and AVX-512 kernels return the same
+// result bit for bit as the scalar one.
+class Query {
+public:
+    static double Sum(const double* values, const size_t& count);
+    static void TopK(const double* values, const size_t& count, const uint32_t& k, std::vector<double>& out);
+    static void Quantiles(const double* values, const size_t& count, const uint32_t& intervals, std::vector<double>& out);
+    static void Histogram(const double* values, const size_t& count, const double& min, const double& max,
+                          const uint32_t& bins, std::vector<uint32_t>& out);
+
+    static const char* KernelName();
+};
+
+#endif // QUERY_HPP
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// xoshiro256** run as eight interleaved lanes.
+// The lane count is fixed, so the scalar, SSE2, AVX2 and AVX-512 kernels all
+// produce the same sequence; the widest one the CPU supports is picked once at
+// startup. Doubles are built from the top 52 bits of each output, which gives
+// uniform values in [0, 1) without a division.
+class Random {
+public:
+    static constexpr size_t LANES = 8;
+
+    Random();
+    explicit Random(const uint64_t& seed);
+
+    void Seed(const uint64_t& seed);
+    // Independent stream `stream` of `seed`, e.g. one per block of a dataset
+    void Seed(const uint64_t& seed, const uint64_t& stream);
+
+    // out[i] = origin + ((first_index + i) * index_step + u_i) * width
+    // index_step = 1 spreads values over consecutive strata of `width`,
+    // index_step = 0 draws every value from [origin, origin + width)
+    void Fill(double* out, const size_t& count, const double& first_index, const double& index_step,
+              const double& origin, const double& width);
+
+    // Counter-based variant: u_i depends only on (seed, first_index + i), so
+    // any slice of a sequence can be regenerated without replaying the rest
+    static void FillCounter(double* out, const size_t& count, const uint64_t& seed, const uint64_t& first_index,
+                            const double& index_step, const double& origin, const double& width);
+
+    static const char* KernelName();
+
+private:
+    alignas(64) uint64_t state_[4][LANES];
+};
+
+#endif // RANDOM_HPP
\ No newline at end of file
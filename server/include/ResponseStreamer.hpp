@@ -0,0 +1,77 @@
+#ifndef RESPONSE_STREAMER_HPP
+#define RESPONSE_STREAMER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "Buffer.hpp"
+#include "Protocol.hpp"
+
+struct StreamJob {
+    struct sockaddr_in client_addr;
+    uint32_t client_id;
+    uint32_t transfer;
+    uint64_t seed;
+    uint32_t count;
+    double min;
+    double max;
+    bool descending;
+    bool compressed;
+    ValuePrecision precision;
+    bool checksums;
+    uint32_t packet_data_size;
+    uint32_t next_packet = 1;
+    // Digest of the chunks produced so far, when checksums are on
+    uint32_t digest = 0;
+};
+
+// Generates responses chunk by chunk on its own thread and hands each chunk
+// to the sender as soon as it is filled, so generation overlaps network I/O.
+// Chunks live in a fixed ring of STREAM_RING_CHUNKS slots; a slot returns to
+// the ring when the last Buffer referencing it is dropped, which bounds
+// memory no matter how large the response is. Values come from the
+// counter-based stream, so a chunk needs nothing but its job. Active jobs
+// take turns one chunk at a time. Chunks of a job are produced in order, so
+// its dataset digest is extended chunk by chunk and complete with the last.
+class ResponseStreamer {
+public:
+    // chunk holds `packets` fragments starting at `first_packet`; `last` is
+    // set on the final chunk of a job
+    using Sink = std::function<void(const StreamJob& job, Buffer chunk, const uint32_t& first_packet,
+                                    const uint32_t& packets, const bool& last)>;
+
+    ResponseStreamer();
+    ResponseStreamer(const ResponseStreamer&) = delete;
+    ~ResponseStreamer();
+
+    void Start(Sink sink);
+    void Submit(const StreamJob& job);
+
+private:
+    void Produce();
+    uint32_t AcquireSlot(std::unique_lock<std::mutex>& lock);
+    void ReleaseSlot(const uint32_t& slot);
+
+    Sink sink_;
+    std::unique_ptr<double[]> ring_;
+    std::vector<uint32_t> free_slots_;
+    std::deque<StreamJob> jobs_;
+    bool stop_ = false;
+    std::mutex mx_streamer_;
+    std::condition_variable cv_streamer_;
+    std::thread producer_;
+};
+
+#endif // RESPONSE_STREAMER_HPP
\ No newline at end of file
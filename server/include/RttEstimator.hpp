@@ -0,0 +1,27 @@
+#ifndef RTT_ESTIMATOR_HPP
+#define RTT_ESTIMATOR_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// Smoothed RTT and retransmission timeout as in RFC 6298, plus the tail-loss
+// probe timeout (2 * SRTT) used before falling back to the full RTO.
+class RttEstimator {
+public:
+    using Duration = std::chrono::microseconds;
+
+    RttEstimator();
+    void AddSample(const Duration& sample);
+    bool HasSample() const;
+    Duration Srtt() const;
+    Duration Rto() const;
+    Duration ProbeTimeout() const;
+    Duration Backoff(const uint32_t& attempt) const;
+
+private:
+    Duration srtt_;
+    Duration rttvar_;
+    bool has_sample_;
+};
+
+#endif // RTT_ESTIMATOR_HPP
\ No newline at end of file
@@ -4,13 +4,16 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstddef>
 #include <deque>
 #include <thread>
 #include <memory>
 #include <mutex>
 #include <array>
-#include <unordered_set>
-#include <random>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <functional>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -19,6 +22,7 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 #include "ConfReader.hpp"
@@ -26,6 +30,23 @@
 #include "Logger.hpp"
 #include "Constants.hpp"
 #include "Protocol.hpp"
+#include "TimerWheel.hpp"
+#include "RttEstimator.hpp"
+#include "Generator.hpp"
+#include "DatasetPool.hpp"
+#include "ResponseStreamer.hpp"
+#include "Query.hpp"
+#include "FragmentCodec.hpp"
+#include "Precision.hpp"
+#include "Crc32c.hpp"
+#include "Bundle.hpp"
+
+enum class TimerKind : uint8_t {
+    SESSION_IDLE = 0,
+    RESPONSE_RETENTION = 1,
+    RETRANSMIT = 2,
+    STREAM_TICK = 3
+};
 
 struct Packet {
     struct sockaddr_in client_addr;
@@ -36,11 +57,37 @@ struct Packet {
 struct ToSend {
     MessageType type;
     struct sockaddr_in client_addr;
-    uint32_t data_size;
-    char* data;
-    bool custom_packet_number;
-    bool delete_data;
-    uint16_t* packet_numbers;
+    uint32_t client_id = INVALID_CLIENT_ID;
+    // With a client_id: the client's transfer the response belongs to
+    uint32_t transfer = 0;
+    Buffer data;
+    // RESPONSE only: fragments to send, all of them when empty
+    std::vector<uint16_t> packet_numbers;
+    // Non-zero when data holds just the listed fragments, back to back
+    uint32_t packets_total = 0;
+    // RESPONSE only: encode each fragment with FragmentCodec
+    bool compressed = false;
+    // RESPONSE only: format of the values in data
+    ValuePrecision precision = ValuePrecision::FLOAT64;
+    // RESPONSE only: append checksum trailers; the final fragment also
+    // carries `digest` once it is known
+    bool checksums = false;
+    bool digest_ready = false;
+    uint32_t digest = 0;
+    // Payload bytes per datagram: per fragment for a RESPONSE, and the size
+    // other messages are split at
+    uint32_t packet_data_size = DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE;
+    // RESPONSE only: sub-stream of a batch, whose fragments go out numbered
+    // packet_offset + n of transfer_packets; packet_numbers and data stay
+    // those of the sub-stream
+    uint32_t packet_offset = 0;
+    uint32_t transfer_packets = 0;
+    // Other types: the peer takes BUNDLE datagrams of up to this many bytes,
+    // 0 if it does not
+    uint32_t bundle_size = 0;
+    // STREAM_DATA only: data holds whole datagrams of this size back to
+    // back, the last one possibly shorter
+    uint32_t datagram_size = 0;
 };
 
 class Server {
@@ -54,25 +101,75 @@ public:
     void StartReceiving();
     void StartSending();
     void ReadConfigs();
-    bool SendMessage(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size, const MessageType& type, uint16_t* packet_numbers = nullptr);
-    bool CheckVersion(const uint32_t& version_major, const uint32_t& version_minor);
+    bool SendMessage(const ToSend& to_send);
+    bool SendFragments(const ToSend& to_send);
+    bool SendDatagrams(const ToSend& to_send);
+    void SendBundled(ToSend to_send);
+    void Dispatch(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void ProcessBundle(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    bool CheckVersion(const uint32_t& version_major);
     bool ProcessRequest(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
     void ProcessMissedPackets(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void QueueFragments(const Client& client, const Dataset& dataset, const uint16_t* numbers, const uint32_t& count);
+    void QueueSubStream(ToSend to_send, const Dataset& dataset, const uint16_t* numbers, const uint32_t& count);
+    bool ProcessBatchRequest(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    bool GenerateBatchPart(Dataset& part, Buffer& data);
+    void StartTransfer(Client& client, Dataset* dataset);
+    void ProcessCumulativeAck(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void SendWindow(Client& client);
+    void HoldInChunks(Dataset& dataset);
+    void ReleaseAcknowledged(Dataset& dataset, const uint32_t& received_through);
+    void ProcessSubscribe(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void ProcessUnsubscribe(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void ProcessStreamReport(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    void StreamTick(Client& client);
+    void EndSubscription(Client& client);
+    void QueueMessage(ToSend to_send);
+    void QueueMessages(std::vector<ToSend>& batch);
+    void QueueReply(ToSend to_send);
     void ProcessAcknowledge(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
     void ProcessConnect(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
-    void SendAcknowledge(const struct sockaddr_in& client_addr, const uint32_t& client_id, const uint32_t& packet_number);
-    ToSend DoBusinessLogic(const uint32_t& client_id, const double& value);
-    void SendError(const struct sockaddr_in& client_addr, const ErrorCode& code);
+    void ProcessQuery(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size);
+    bool ValueRange(const double& value, double& min, double& max);
+    void SendAcknowledge(const struct sockaddr_in& client_addr, const uint32_t& client_id, const uint32_t& packet_number,
+                         const ConnectHeader& session);
+    uint32_t Capabilities();
+    uint32_t BundleSize(const Client& client);
+    ToSend DoBusinessLogic(const struct sockaddr_in& client_addr, const uint32_t& client_id, const double& value,
+                           const uint8_t& flags, const ValuePrecision& precision);
+    Buffer NarrowDataset(const Dataset& dataset, const double* values);
+    void SendError(const struct sockaddr_in& client_addr, const ErrorCode& code, const uint32_t& bundle_size = 0);
+    void OnTimer(const TimerKind& kind, const uint64_t& context);
+    void TouchClient(Client& client);
+    void CloseSession(Client& client);
+    void PostTask(std::function<void()> task);
+    void OnResponseSent(const uint32_t& client_id, const struct sockaddr_in& client_addr, const uint32_t& transfer);
+    void ArmRetransmit(Client& client);
+    void SendTailProbe(Client& client);
+    void QueueChunk(const StreamJob& job, Buffer chunk, const uint32_t& first_packet, const uint32_t& packets, const bool& last);
 
     ~Server();
 private:
     ClientHandler client_handler_;
+    TimerWheel timers_;
+    RttEstimator rtt_;
+    Generator generator_;
+    DatasetPool pool_;
+    ResponseStreamer streamer_;
     std::vector<std::thread> processing_threads_;
     std::thread receiving_thread_;
     std::thread sending_thread_;
     std::thread processing_thread_;
     std::deque<ToSend> sending_data_;
     std::deque<Packet> packets_;
+    std::deque<std::function<void()>> tasks_;
+    // Every reply to the messages of the BUNDLE being processed, queued at
+    // once and in order when it is done, so that control replies leave
+    // bundled too and none overtakes the reply to an earlier message
+    bool holding_replies_ = false;
+    std::vector<ToSend> held_replies_;
+    // Subscription datagrams of the timers that fired, queued at once
+    std::vector<ToSend> stream_sends_;
     ConfReader reader_;
     ServerConfig server_conf_;
     ProtocolConfig protocol_conf_;
@@ -0,0 +1,63 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+using TimerId = uint64_t;
+constexpr TimerId INVALID_TIMER_ID = 0;
+
+// Hierarchical timing wheel (4 levels x 256 slots).
+// Schedule and Cancel are O(1); a timer is moved down at most three times
+// before it fires. Nodes live in a flat pool linked by index, so millions of
+// pending timers cost a few tens of bytes each and no allocation once the
+// pool has grown. Not thread safe: owned and driven by one thread.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Handler = std::function<void(const uint8_t& kind, const uint64_t& context)>;
+
+    TimerWheel(const std::chrono::milliseconds& tick = std::chrono::milliseconds(1));
+
+    TimerId Schedule(const std::chrono::milliseconds& delay, const uint8_t& kind, const uint64_t& context);
+    bool Cancel(TimerId& timer_id);
+    void Advance(const Clock::time_point& now, const Handler& handler);
+    Clock::time_point NextExpiry() const;
+    bool Empty() const;
+    size_t Size() const;
+
+private:
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+    static constexpr uint32_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint32_t NIL = 0xFFFFFFFF;
+
+    struct Node {
+        uint64_t expires;
+        uint64_t context;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t generation;
+        uint32_t slot;
+        uint8_t kind;
+    };
+
+    uint64_t TickOf(const Clock::time_point& time) const;
+    void Link(const uint32_t& index);
+    void Unlink(const uint32_t& index);
+    void Release(const uint32_t& index);
+    void Cascade(const uint32_t& level);
+
+    Clock::duration tick_;
+    Clock::time_point start_;
+    uint64_t now_tick_;
+    size_t size_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    uint32_t slots_[LEVELS * SLOTS];
+};
+
+#endif // TIMER_WHEEL_HPP
\ No newline at end of file
@@ -0,0 +1,197 @@
+#ifndef WIRE_CODEC_HPP
+#define WIRE_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Packed, little-endian wire format for the messages in Protocol.hpp.
+// A message lists its fields once, in wire order, from a static constexpr
+// Fields() returning a tuple of member pointers. WireCodec derives the packed
+// size and every field offset from that list at compile time and copies
+// field by field, so the bytes on the wire depend neither on the host's
+// padding and alignment nor on its byte order. WireView reads single fields
+// straight out of a received datagram, without decoding the whole message.
+//
+// Fields are integers, enums or floating point values; floating point
+// values travel as the little-endian bytes of their IEEE 754 bit pattern.
+// Messages grow by appending fields, which DecodePrefix reads from peers
+// that still send the shorter form.
+
+template<size_t BYTES>
+struct WireBits;
+
+template<>
+struct WireBits<1> {
+    using Type = uint8_t;
+};
+
+template<>
+struct WireBits<2> {
+    using Type = uint16_t;
+};
+
+template<>
+struct WireBits<4> {
+    using Type = uint32_t;
+};
+
+template<>
+struct WireBits<8> {
+    using Type = uint64_t;
+};
+
+class Wire {
+public:
+    template<class V>
+    static void Store(char* out, const V& value) {
+        static_assert(std::is_arithmetic<V>::value || std::is_enum<V>::value, "wire fields are scalars");
+        typename WireBits<sizeof(V)>::Type bits;
+        memcpy(&bits, &value, sizeof(V));
+        for (size_t i = 0; i < sizeof(V); ++i) {
+            out[i] = static_cast<char>(bits >> (8 * i));
+        }
+    }
+
+    template<class V>
+    static void Load(const char* in, V& value) {
+        static_assert(std::is_arithmetic<V>::value || std::is_enum<V>::value, "wire fields are scalars");
+        typename WireBits<sizeof(V)>::Type bits = 0;
+        for (size_t i = 0; i < sizeof(V); ++i) {
+            bits |= static_cast<typename WireBits<sizeof(V)>::Type>(static_cast<uint8_t>(in[i])) << (8 * i);
+        }
+        memcpy(&value, &bits, sizeof(V));
+    }
+
+    // Arrays of scalars that follow a message header
+    template<class V>
+    static void StoreArray(char* out, const V* values, const size_t& count) {
+        for (size_t i = 0; i < count; ++i) {
+            Store(out + i * sizeof(V), values[i]);
+        }
+    }
+
+    template<class V>
+    static void LoadArray(const char* in, V* values, const size_t& count) {
+        for (size_t i = 0; i < count; ++i) {
+            Load(in + i * sizeof(V), values[i]);
+        }
+    }
+
+    template<class C, class V>
+    static constexpr size_t FieldSize(V C::*) {
+        return sizeof(V);
+    }
+
+    template<class C, class V>
+    static V FieldType(V C::*);
+
+    // Position of MEMBER in a Fields() tuple, the tuple size if it is not there
+    template<auto MEMBER, size_t I = 0, class Fields>
+    static constexpr size_t IndexOf(const Fields& fields) {
+        if constexpr (I == std::tuple_size<Fields>::value) {
+            return I;
+        } else {
+            if constexpr (std::is_same<typename std::tuple_element<I, Fields>::type, decltype(MEMBER)>::value) {
+                if (std::get<I>(fields) == MEMBER) {
+                    return I;
+                }
+            }
+            return IndexOf<MEMBER, I + 1>(fields);
+        }
+    }
+
+    template<class Fields, size_t... I>
+    static constexpr size_t SizeOf(const Fields& fields, std::index_sequence<I...>) {
+        return (FieldSize(std::get<I>(fields)) + ... + 0);
+    }
+};
+
+template<class T>
+class WireCodec {
+public:
+    static constexpr auto FIELDS = T::Fields();
+    static constexpr size_t COUNT = std::tuple_size<decltype(FIELDS)>::value;
+    // Bytes the message takes on the wire
+    static constexpr size_t SIZE = Wire::SizeOf(FIELDS, std::make_index_sequence<COUNT>());
+
+    // Offset of the I-th field
+    template<size_t I>
+    static constexpr size_t OFFSET = Wire::SizeOf(FIELDS, std::make_index_sequence<I>());
+
+    template<auto MEMBER>
+    static constexpr size_t Offset() {
+        constexpr size_t index = Wire::IndexOf<MEMBER>(FIELDS);
+        static_assert(index < COUNT, "not a wire field of this message");
+        return OFFSET<index>;
+    }
+
+    // `out` must hold SIZE bytes
+    static void Encode(const T& message, char* out) {
+        EncodeFields(message, out, std::make_index_sequence<COUNT>());
+    }
+
+    // `in` must hold SIZE bytes
+    static T Decode(const char* in) {
+        T message{};
+        DecodeFields(message, in, std::make_index_sequence<COUNT>());
+        return message;
+    }
+
+    // Decodes the fields that lie completely within `size` bytes; the rest
+    // stay value-initialized
+    static T DecodePrefix(const char* in, const size_t& size) {
+        T message{};
+        DecodePrefixFields(message, in, size, std::make_index_sequence<COUNT>());
+        return message;
+    }
+
+private:
+    template<size_t... I>
+    static void EncodeFields(const T& message, char* out, std::index_sequence<I...>) {
+        (Wire::Store(out + OFFSET<I>, message.*std::get<I>(FIELDS)), ...);
+    }
+
+    template<size_t... I>
+    static void DecodeFields(T& message, const char* in, std::index_sequence<I...>) {
+        (Wire::Load(in + OFFSET<I>, message.*std::get<I>(FIELDS)), ...);
+    }
+
+    template<size_t... I>
+    static void DecodePrefixFields(T& message, const char* in, const size_t& size, std::index_sequence<I...>) {
+        ((OFFSET<I + 1> <= size ? Wire::Load(in + OFFSET<I>, message.*std::get<I>(FIELDS)) : void()), ...);
+    }
+};
+
+// Reads fields of an encoded message in place, e.g.
+// WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>().
+// The caller checks that the data holds WireCodec<T>::SIZE bytes
+template<class T>
+class WireView {
+public:
+    explicit WireView(const char* data) : data_(data) {}
+
+    template<auto MEMBER>
+    decltype(Wire::FieldType(MEMBER)) Get() const {
+        decltype(Wire::FieldType(MEMBER)) value;
+        Wire::Load(data_ + WireCodec<T>::template Offset<MEMBER>(), value);
+        return value;
+    }
+
+    T Decode() const {
+        return WireCodec<T>::Decode(data_);
+    }
+
+    // Whatever follows the message, e.g. a RESPONSE payload
+    const char* Payload() const {
+        return data_ + WireCodec<T>::SIZE;
+    }
+
+private:
+    const char* data_;
+};
+
+#endif // WIRE_CODEC_HPP
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "Buffer.hpp"
+
+#include <algorithm>
+
+Buffer::Buffer() : data_(nullptr), size_(0) {}
+
+Buffer::Buffer(std::shared_ptr<const void> owner, const char* data, const size_t& size)
+    : owner_(std::move(owner))
+    , data_(data)
+    , size_(size) {}
+
+Buffer Buffer::Copy(const void* data, const size_t& size) {
+    std::shared_ptr<char[]> storage(new char[size]);
+    memcpy(storage.get(), data, size);
+    const char* begin = storage.get();
+    return Buffer(std::move(storage), begin, size);
+}
+
+Buffer Buffer::Share(std::shared_ptr<const void> owner, const void* data, const size_t& size) {
+    return Buffer(std::move(owner), static_cast<const char*>(data), size);
+}
+
+Buffer Buffer::Slice(const size_t& offset, const size_t& size) const {
+    if (offset >= size_) {
+        return Buffer(owner_, data_ + size_, 0);
+    }
+    return Buffer(owner_, data_ + offset, std::min(size, size_ - offset));
+}
+
+const char* Buffer::Data() const {
+    return data_;
+}
+
+size_t Buffer::Size() const {
+    return size_;
+}
+
+bool Buffer::Empty() const {
+    return size_ == 0;
+}
\ No newline at end of file
@@ -1,38 +1,256 @@
 #include "ClientHandler.hpp"
 
-ClientHandler::ClientHandler(const uint32_t& max_clients = 256) {
-    clients_.resize(max_clients);
-    for(int i = 0; i < max_clients; ++i) {
-        available_client_ids_.push_back(i);
+ClientHandler::ClientHandler(const uint32_t& max_clients) {
+    Initialize(max_clients);
+}
+
+bool ClientHandler::Initialize(const uint32_t& max_clients) {
+    std::lock_guard<std::mutex> lock(mx_clients_);
+    clients_.reset(new Client[max_clients]);
+    for (uint32_t i = 0; i < max_clients; ++i) {
+        clients_[i].id = i;
+        clients_[i].transfer = 0;
+        clients_[i].dataset.store(nullptr, std::memory_order_relaxed);
+    }
+    max_clients_ = max_clients;
+
+    // Keep the load factor at or below 0.5 so probe sequences stay short
+    uint32_t capacity = 16;
+    while (capacity < max_clients * 2) {
+        capacity <<= 1;
+    }
+    delete table_.exchange(CreateTable(capacity));
+
+    // Bits past max_clients are marked as taken so they are never handed out
+    id_bitmap_.assign((max_clients + 63) / 64, 0);
+    if (max_clients % 64 != 0) {
+        id_bitmap_.back() = ~0ULL << (max_clients % 64);
+    }
+    id_hint_ = 0;
+    tombstones_ = 0;
+    size_ = 0;
+
+    return true;
+}
+
+uint64_t ClientHandler::Hash(const uint32_t& addr, const uint16_t& port, const uint32_t& id) {
+    uint64_t key = ((static_cast<uint64_t>(addr) << 32) | (static_cast<uint64_t>(port) << 16))
+                 ^ (static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ULL);
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+ClientHandler::Table* ClientHandler::CreateTable(const uint32_t& capacity) {
+    Table* table = new Table;
+    table->mask = capacity - 1;
+    table->slots.reset(new std::atomic<uint32_t>[capacity]);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        table->slots[i].store(EMPTY_SLOT, std::memory_order_relaxed);
+    }
+    return table;
+}
+
+uint32_t ClientHandler::HomeSlot(const Table& table, const uint32_t& id) {
+    const struct sockaddr_in& addr = clients_[id].client_addr;
+    return Hash(addr.sin_addr.s_addr, addr.sin_port, id) & table.mask;
+}
+
+void ClientHandler::Insert(Table& table, const uint32_t& home, const uint32_t& id) {
+    uint32_t index = home;
+    while (true) {
+        uint32_t value = table.slots[index].load(std::memory_order_relaxed);
+        if (value == EMPTY_SLOT || value == DELETED_SLOT) {
+            table.slots[index].store(id + 1, std::memory_order_release);
+            return;
+        }
+        index = (index + 1) & table.mask;
+    }
+}
+
+uint32_t ClientHandler::FindSlot(const Table& table, const uint32_t& addr, const uint16_t& port, const uint32_t& id) {
+    uint32_t index = Hash(addr, port, id) & table.mask;
+    for (uint32_t probes = 0; probes <= table.mask; ++probes) {
+        uint32_t value = table.slots[index].load(std::memory_order_acquire);
+        if (value == EMPTY_SLOT) {
+            break;
+        }
+        if (value == id + 1) {
+            const struct sockaddr_in& client_addr = clients_[id].client_addr;
+            if (client_addr.sin_addr.s_addr == addr && client_addr.sin_port == port) {
+                return index;
+            }
+            break;
+        }
+        index = (index + 1) & table.mask;
+    }
+    return INVALID_CLIENT_ID;
+}
+
+uint32_t ClientHandler::AllocateId() {
+    const uint32_t words = id_bitmap_.size();
+    for (uint32_t i = 0; i < words; ++i) {
+        uint32_t word = (id_hint_ + i) % words;
+        if (id_bitmap_[word] != ~0ULL) {
+            uint32_t bit = __builtin_ctzll(~id_bitmap_[word]);
+            id_bitmap_[word] |= 1ULL << bit;
+            id_hint_ = word;
+            return word * 64 + bit;
+        }
+    }
+    return INVALID_CLIENT_ID;
+}
+
+void ClientHandler::ReleaseId(const uint32_t& id) {
+    id_bitmap_[id / 64] &= ~(1ULL << (id % 64));
+}
+
+ClientHandler::Table* ClientHandler::Rebuild() {
+    // Readers may be probing the current table, so tombstones are dropped by
+    // publishing a fresh copy and retiring the old one
+    Table* old_table = table_.load(std::memory_order_relaxed);
+    Table* new_table = CreateTable(old_table->mask + 1);
+    for (uint32_t i = 0; i <= old_table->mask; ++i) {
+        uint32_t value = old_table->slots[i].load(std::memory_order_relaxed);
+        if (value != EMPTY_SLOT && value != DELETED_SLOT) {
+            Insert(*new_table, HomeSlot(*new_table, value - 1), value - 1);
+        }
     }
+    table_.store(new_table, std::memory_order_release);
+    tombstones_ = 0;
+    return old_table;
+}
+
+void ClientHandler::RetireTable(Table* table) {
+    epoch_.Retire([table]() { delete table; });
 }
 
 uint32_t ClientHandler::AddClient(const struct sockaddr_in& client_addr) {
-    Client client;
+    std::unique_lock<std::mutex> lock(mx_clients_);
+    uint32_t id = AllocateId();
+    if (id == INVALID_CLIENT_ID) {
+        return INVALID_CLIENT_ID;
+    }
+
+    Client& client = clients_[id];
     client.client_addr = client_addr;
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_ids_);
-        client.id = available_client_ids_[0];
-        available_client_ids_.pop_front();
+    client.dataset.store(nullptr, std::memory_order_relaxed);
+    client.last_activity = std::chrono::steady_clock::now();
+    client.idle_timer = INVALID_TIMER_ID;
+    client.retention_timer = INVALID_TIMER_ID;
+    client.retransmit_timer = INVALID_TIMER_ID;
+    client.response_sent_at = std::chrono::steady_clock::time_point();
+    client.probes_sent = 0;
+    client.retransmitted = false;
+    client.receive_window = 0;
+    client.received_through = 0;
+    client.next_fragment = 1;
+    client.subscription_rate = 0;
+    client.stream_timer = INVALID_TIMER_ID;
+
+    Table* table = table_.load(std::memory_order_relaxed);
+    uint32_t index = HomeSlot(*table, id);
+    while (true) {
+        uint32_t value = table->slots[index].load(std::memory_order_relaxed);
+        if (value == EMPTY_SLOT) {
+            break;
+        }
+        if (value == DELETED_SLOT) {
+            --tombstones_;
+            break;
+        }
+        index = (index + 1) & table->mask;
     }
-    
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_clients_);
-        clients_[client.id] = client;
+    table->slots[index].store(id + 1, std::memory_order_release);
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    bool rebuild = (size_.load(std::memory_order_relaxed) + tombstones_) * 4 > (table->mask + 1) * 3;
+    Table* old_table = rebuild ? Rebuild() : nullptr;
+    lock.unlock();
+    if (old_table != nullptr) {
+        RetireTable(old_table);
     }
 
-    return client.id;
+    return id;
 }
 
-bool ClientHandler::RemoveClient(const uint32_t& client_id) {
+bool ClientHandler::RemoveClient(const uint32_t& client_id, const struct sockaddr_in& client_addr) {
+    if (client_id >= max_clients_) {
+        return false;
+    }
+
+    Dataset* dataset = nullptr;
+    Table* old_table = nullptr;
     {
-        std::lock_guard<std::mutex> lock(mx_deque_ids_);
-        available_client_ids_.push_back(client_id);
+        std::lock_guard<std::mutex> lock(mx_clients_);
+        Table* table = table_.load(std::memory_order_relaxed);
+        uint32_t index = FindSlot(*table, client_addr.sin_addr.s_addr, client_addr.sin_port, client_id);
+        if (index == INVALID_CLIENT_ID) {
+            return false;
+        }
+        table->slots[index].store(DELETED_SLOT, std::memory_order_release);
+        ++tombstones_;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        dataset = clients_[client_id].dataset.exchange(nullptr, std::memory_order_acq_rel);
+        if (tombstones_ * 4 > table->mask + 1) {
+            old_table = Rebuild();
+        }
+    }
+
+    // The id goes back to the bitmap only after readers are done with the slot
+    epoch_.Retire([this, client_id, dataset]() {
+        delete dataset;
+        std::lock_guard<std::mutex> lock(mx_clients_);
+        ReleaseId(client_id);
+    });
+
+    if (old_table != nullptr) {
+        RetireTable(old_table);
     }
 
     return true;
 }
 
-Client& ClientHandler::GetClient(const uint32_t& client_id) {
-    return clients_[client_id];
+Client* ClientHandler::GetClient(const uint32_t& client_id, const struct sockaddr_in& client_addr) {
+    if (client_id >= max_clients_) {
+        return nullptr;
+    }
+    const Table* table = table_.load(std::memory_order_acquire);
+    if (FindSlot(*table, client_addr.sin_addr.s_addr, client_addr.sin_port, client_id) == INVALID_CLIENT_ID) {
+        return nullptr;
+    }
+    return &clients_[client_id];
+}
+
+// For callers that already hold a trusted id, e.g. timers of a live session
+Client* ClientHandler::GetClient(const uint32_t& client_id) {
+    if (client_id >= max_clients_) {
+        return nullptr;
+    }
+    return GetClient(client_id, clients_[client_id].client_addr);
+}
+
+void ClientHandler::SetDataset(Client& client, Dataset* dataset) {
+    Dataset* old_dataset = client.dataset.exchange(dataset, std::memory_order_acq_rel);
+    if (old_dataset != nullptr) {
+        epoch_.Retire([old_dataset]() { delete old_dataset; });
+    }
+}
+
+EpochManager& ClientHandler::GetEpoch() {
+    return epoch_;
+}
+
+uint32_t ClientHandler::Size() {
+    return size_.load(std::memory_order_relaxed);
+}
+
+ClientHandler::~ClientHandler() {
+    for (uint32_t i = 0; i < max_clients_; ++i) {
+        delete clients_[i].dataset.load(std::memory_order_relaxed);
+    }
+    delete table_.load(std::memory_order_relaxed);
 }
\ No newline at end of file
@@ -3,8 +3,6 @@
 
 using json = nlohmann::json_abi_v3_11_3::json;
 
-ServerConfig::ServerConfig(const int& port) : server_port(port) {}
-
 ProtocolConfig::ProtocolConfig(const uint32_t& val_amount)
     : values_amount(val_amount) {}
 
@@ -14,7 +12,28 @@ ServerConfig ConfReader::ReadServerConfig() {
     std::ifstream f(path_ + "serverconf.json");
     json data = json::parse(f);
     std::cout << "Port: " << data["port"] << "\n";
-    ServerConfig conf(data["port"]);
+    ServerConfig conf;
+    conf.server_port = data["port"];
+    conf.max_clients = data.value("max_clients", conf.max_clients);
+    conf.session_idle_timeout_ms = data.value("session_idle_timeout_ms", conf.session_idle_timeout_ms);
+    conf.response_retention_ms = data.value("response_retention_ms", conf.response_retention_ms);
+    conf.stateless_datasets = data.value("stateless_datasets", conf.stateless_datasets);
+    conf.seed_responses = data.value("seed_responses", conf.seed_responses);
+    conf.pool_values = data.value("pool_values", conf.pool_values);
+    conf.pool_depth = data.value("pool_depth", conf.pool_depth);
+    conf.pool_memory_limit_mb = data.value("pool_memory_limit_mb", conf.pool_memory_limit_mb);
+    conf.streaming_responses = data.value("streaming_responses", conf.streaming_responses);
+    conf.compressed_responses = data.value("compressed_responses", conf.compressed_responses);
+    conf.reduced_precision = data.value("reduced_precision", conf.reduced_precision);
+    conf.response_checksums = data.value("response_checksums", conf.response_checksums);
+    conf.max_packet_size = data.value("max_packet_size", conf.max_packet_size);
+    conf.bundled_messages = data.value("bundled_messages", conf.bundled_messages);
+    conf.bundle_delay_us = data.value("bundle_delay_us", conf.bundle_delay_us);
+    conf.batch_requests = data.value("batch_requests", conf.batch_requests);
+    conf.flow_control = data.value("flow_control", conf.flow_control);
+    conf.best_effort_transfers = data.value("best_effort_transfers", conf.best_effort_transfers);
+    conf.subscriptions = data.value("subscriptions", conf.subscriptions);
+    conf.max_subscription_rate = data.value("max_subscription_rate", conf.max_subscription_rate);
     return conf;
 }
 
@@ -0,0 +1,182 @@
+#include "Crc32c.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+using Kernel = uint32_t (*)(uint32_t crc, const uint8_t* data, size_t size);
+
+constexpr uint32_t POLYNOMIAL = 0x82F63B78;
+
+// a * b modulo the polynomial, both in reflected bit order
+uint32_t MultiplyModP(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t m = 1U << 31; m != 0; m >>= 1) {
+        if ((a & m) != 0) {
+            product ^= b;
+        }
+        b = (b & 1) != 0 ? (b >> 1) ^ POLYNOMIAL : b >> 1;
+    }
+    return product;
+}
+
+// x^(8 * bytes) modulo the polynomial
+uint32_t ShiftOperator(const size_t& bytes) {
+    uint32_t result = 1U << 31;
+    uint32_t square = 1U << 30;
+    for (size_t bits = 8 * bytes; bits != 0; bits >>= 1) {
+        if ((bits & 1) != 0) {
+            result = MultiplyModP(square, result);
+        }
+        square = MultiplyModP(square, square);
+    }
+    return result;
+}
+
+struct Tables {
+    // slice[k][b]: CRC of byte b followed by k zero bytes
+    uint32_t slice[8][256];
+    // shift[k][b]: byte b at position k of a CRC, moved past LANE_SIZE zero bytes
+    uint32_t shift[4][256];
+
+    Tables() {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (uint32_t bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) != 0 ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+            }
+            slice[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (uint32_t k = 1; k < 8; ++k) {
+                slice[k][b] = (slice[k - 1][b] >> 8) ^ slice[0][slice[k - 1][b] & 0xFF];
+            }
+        }
+        const uint32_t lane = ShiftOperator(Crc32c::LANE_SIZE);
+        for (uint32_t k = 0; k < 4; ++k) {
+            for (uint32_t b = 0; b < 256; ++b) {
+                shift[k][b] = MultiplyModP(lane, b << (8 * k));
+            }
+        }
+    }
+};
+
+const Tables& GetTables() {
+    static const Tables tables;
+    return tables;
+}
+
+// CRC of A followed by LANE_SIZE bytes, given the CRC of A with the
+// register already past those bytes: a linear map, applied a byte at a time
+inline uint32_t ShiftLane(const Tables& tables, const uint32_t& crc) {
+    return tables.shift[0][crc & 0xFF] ^ tables.shift[1][(crc >> 8) & 0xFF]
+         ^ tables.shift[2][(crc >> 16) & 0xFF] ^ tables.shift[3][crc >> 24];
+}
+
+uint32_t ExtendScalar(uint32_t crc, const uint8_t* data, size_t size) {
+    const Tables& tables = GetTables();
+    uint32_t c = ~crc;
+    while (size >= 8) {
+        const uint32_t low = c ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8
+                                  | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        const uint32_t high = static_cast<uint32_t>(data[4]) | static_cast<uint32_t>(data[5]) << 8
+                            | static_cast<uint32_t>(data[6]) << 16 | static_cast<uint32_t>(data[7]) << 24;
+        c = tables.slice[7][low & 0xFF] ^ tables.slice[6][(low >> 8) & 0xFF]
+          ^ tables.slice[5][(low >> 16) & 0xFF] ^ tables.slice[4][low >> 24]
+          ^ tables.slice[3][high & 0xFF] ^ tables.slice[2][(high >> 8) & 0xFF]
+          ^ tables.slice[1][(high >> 16) & 0xFF] ^ tables.slice[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        c = (c >> 8) ^ tables.slice[0][(c ^ *data++) & 0xFF];
+        --size;
+    }
+    return ~c;
+}
+
+#ifdef CRC32C_X86_DISPATCH
+__attribute__((target("sse4.2")))
+inline uint64_t Load64(const uint8_t* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+__attribute__((target("sse4.2")))
+uint32_t ExtendSse42(uint32_t crc, const uint8_t* data, size_t size) {
+    const Tables& tables = GetTables();
+    uint64_t c = ~crc;
+    #ifdef __x86_64__
+    // crc32 has a latency of three cycles and a throughput of one, so three
+    // independent lanes keep it busy. Lanes 1 and 2 start from an empty CRC
+    // and are folded in behind lane 0 once done
+    while (size >= 3 * Crc32c::LANE_SIZE) {
+        uint64_t c1 = 0xFFFFFFFF;
+        uint64_t c2 = 0xFFFFFFFF;
+        for (size_t i = 0; i < Crc32c::LANE_SIZE; i += 8) {
+            c = _mm_crc32_u64(c, Load64(data + i));
+            c1 = _mm_crc32_u64(c1, Load64(data + Crc32c::LANE_SIZE + i));
+            c2 = _mm_crc32_u64(c2, Load64(data + 2 * Crc32c::LANE_SIZE + i));
+        }
+        uint32_t merged = ShiftLane(tables, ~static_cast<uint32_t>(c)) ^ ~static_cast<uint32_t>(c1);
+        merged = ShiftLane(tables, merged) ^ ~static_cast<uint32_t>(c2);
+        c = ~merged;
+        data += 3 * Crc32c::LANE_SIZE;
+        size -= 3 * Crc32c::LANE_SIZE;
+    }
+    while (size >= 8) {
+        c = _mm_crc32_u64(c, Load64(data));
+        data += 8;
+        size -= 8;
+    }
+    #endif
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (size > 0) {
+        c32 = _mm_crc32_u8(c32, *data++);
+        --size;
+    }
+    return ~c32;
+}
+#endif
+
+struct Dispatch {
+    Kernel kernel;
+    const char* name;
+};
+
+Dispatch Select() {
+#ifdef CRC32C_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Dispatch{ExtendSse42, "sse4.2"};
+    }
+#endif
+    return Dispatch{ExtendScalar, "slicing-by-8"};
+}
+
+const Dispatch& Selected() {
+    static const Dispatch dispatch = Select();
+    return dispatch;
+}
+}
+
+uint32_t Crc32c::Compute(const void* data, const size_t& size) {
+    return Extend(0, data, size);
+}
+
+uint32_t Crc32c::Extend(const uint32_t& crc, const void* data, const size_t& size) {
+    return Selected().kernel(crc, static_cast<const uint8_t*>(data), size);
+}
+
+uint32_t Crc32c::ExtendPortable(const uint32_t& crc, const void* data, const size_t& size) {
+    return ExtendScalar(crc, static_cast<const uint8_t*>(data), size);
+}
+
+const char* Crc32c::KernelName() {
+    return Selected().name;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "DatasetPool.hpp"
+
+#include <cmath>
+
+DatasetPool::DatasetPool() {}
+
+DatasetPool::~DatasetPool() {
+    {
+        std::lock_guard<std::mutex> lock(mx_pool_);
+        stop_ = true;
+    }
+    cv_pool_.notify_all();
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+}
+
+void DatasetPool::Start(const uint32_t& count, const std::vector<double>& values, const uint32_t& depth,
+                        const size_t& memory_limit, const bool& stateless) {
+    if (values.empty() || depth == 0 || count == 0) {
+        return;
+    }
+    count_ = count;
+    depth_ = depth;
+    memory_limit_ = memory_limit;
+    stateless_ = stateless;
+    for (const double& value : values) {
+        // A request for v asks for [-|v|, |v|), so the sign does not matter
+        if (value != 0 && std::isfinite(value)) {
+            slots_.push_back(Slot{std::fabs(value), {}, false});
+        }
+    }
+    if (!slots_.empty()) {
+        producer_ = std::thread([this]() { Produce(); });
+    }
+}
+
+DatasetPool::Slot* DatasetPool::NextToFill() {
+    const size_t bytes = static_cast<size_t>(count_) * sizeof(double);
+    if (memory_used_ + bytes > memory_limit_) {
+        return nullptr;
+    }
+    // Refill the emptiest value first so one hot value cannot starve the rest
+    Slot* next = nullptr;
+    for (auto& slot : slots_) {
+        if (!slot.disabled && slot.ready.size() < depth_ && (next == nullptr || slot.ready.size() < next->ready.size())) {
+            next = &slot;
+        }
+    }
+    return next;
+}
+
+void DatasetPool::Produce() {
+    std::unique_lock<std::mutex> lock(mx_pool_);
+    while (true) {
+        Slot* slot = nullptr;
+        cv_pool_.wait(lock, [this, &slot]() {
+            slot = NextToFill();
+            return stop_ || slot != nullptr;
+        });
+        if (stop_) {
+            return;
+        }
+
+        // Slots are never added or removed after Start, so the pointer stays
+        // valid while the lock is released for generation
+        const double max = slot->value;
+        lock.unlock();
+        Entry entry;
+        entry.seed = generator_.NextSeed();
+        std::vector<double> values;
+        bool ok = false;
+        if (stateless_) {
+            entry.stateless = ok = generator_.GenerateStateless(values, count_, -max, max, entry.seed);
+        }
+        if (!ok) {
+            entry.stateless = false;
+            ok = generator_.GenerateUnique(values, count_, -max, max, entry.seed);
+        }
+        entry.data = Buffer::Adopt(std::move(values));
+        lock.lock();
+
+        if (!ok) {
+            slot->disabled = true;
+            continue;
+        }
+        memory_used_ += entry.data.Size();
+        slot->ready.push_back(std::move(entry));
+    }
+}
+
+bool DatasetPool::Take(const double& value, Entry& entry) {
+    const double key = std::fabs(value);
+    {
+        std::lock_guard<std::mutex> lock(mx_pool_);
+        for (auto& slot : slots_) {
+            if (slot.value == key && !slot.ready.empty()) {
+                entry = std::move(slot.ready.front());
+                slot.ready.pop_front();
+                memory_used_ -= entry.data.Size();
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                cv_pool_.notify_one();
+                return true;
+            }
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool DatasetPool::Borrow(const double& value, Entry& entry) {
+    const double key = std::fabs(value);
+    std::lock_guard<std::mutex> lock(mx_pool_);
+    for (auto& slot : slots_) {
+        if (slot.value == key && !slot.ready.empty()) {
+            entry = slot.ready.front();
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t DatasetPool::Hits() const {
+    return hits_.load(std::memory_order_relaxed);
+}
+
+uint64_t DatasetPool::Misses() const {
+    return misses_.load(std::memory_order_relaxed);
+}
\ No newline at end of file
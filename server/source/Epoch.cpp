@@ -0,0 +1,148 @@
+#include "Epoch.hpp"
+
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> next_manager_id(0);
+
+// Ids of the managers still alive, so exiting threads only release slots of
+// those. Never destroyed: threads can exit during static destruction
+std::mutex& LiveMutex() {
+    static std::mutex* mx = new std::mutex;
+    return *mx;
+}
+
+std::unordered_set<uint64_t>& LiveManagers() {
+    static std::unordered_set<uint64_t>* managers = new std::unordered_set<uint64_t>;
+    return *managers;
+}
+}
+
+class EpochManager::ThreadSlots {
+public:
+    ~ThreadSlots() {
+        std::lock_guard<std::mutex> lock(LiveMutex());
+        for (auto& slot : slots) {
+            if (LiveManagers().count(slot.owner_id) != 0) {
+                slot.participant->epoch.store(QUIESCENT, std::memory_order_release);
+                slot.participant->in_use.store(false, std::memory_order_release);
+            }
+        }
+    }
+
+    std::vector<LocalSlot> slots;
+    // Where the last lookup hit; threads mostly stay with one manager
+    size_t last = 0;
+};
+
+EpochManager::EpochManager() : id_(next_manager_id.fetch_add(1)), global_epoch_(0) {
+    for (auto& participant : participants_) {
+        participant.epoch.store(QUIESCENT, std::memory_order_relaxed);
+        participant.in_use.store(false, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(LiveMutex());
+    LiveManagers().insert(id_);
+}
+
+EpochManager::~EpochManager() {
+    {
+        std::lock_guard<std::mutex> lock(LiveMutex());
+        LiveManagers().erase(id_);
+    }
+    // No readers can be left once the owner is being destroyed
+    for (auto& retired : retired_) {
+        retired.deleter();
+    }
+}
+
+EpochManager::LocalSlot& EpochManager::Local() {
+    static thread_local ThreadSlots thread_slots;
+    std::vector<LocalSlot>& slots = thread_slots.slots;
+    if (thread_slots.last < slots.size() && slots[thread_slots.last].owner == this
+        && slots[thread_slots.last].owner_id == id_) {
+        return slots[thread_slots.last];
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i].owner == this && slots[i].owner_id == id_) {
+            thread_slots.last = i;
+            return slots[i];
+        }
+    }
+
+    for (auto& participant : participants_) {
+        bool expected = false;
+        if (participant.in_use.compare_exchange_strong(expected, true)) {
+            // The entry of a destroyed manager at the same address is reused
+            size_t i = 0;
+            while (i < slots.size() && slots[i].owner != this) {
+                ++i;
+            }
+            if (i == slots.size()) {
+                slots.emplace_back();
+            }
+            slots[i] = LocalSlot{this, id_, &participant, 0};
+            thread_slots.last = i;
+            return slots[i];
+        }
+    }
+    throw std::runtime_error("EpochManager: too many reader threads");
+}
+
+void EpochManager::Enter() {
+    LocalSlot& slot = Local();
+    if (slot.depth++ == 0) {
+        slot.participant->epoch.store(global_epoch_.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void EpochManager::Exit() {
+    LocalSlot& slot = Local();
+    if (--slot.depth == 0) {
+        slot.participant->epoch.store(QUIESCENT, std::memory_order_release);
+    }
+}
+
+void EpochManager::Retire(std::function<void()> deleter) {
+    {
+        std::lock_guard<std::mutex> lock(mx_retired_);
+        retired_.push_back(Retired{global_epoch_.load(std::memory_order_seq_cst), std::move(deleter)});
+    }
+    Collect();
+}
+
+bool EpochManager::TryAdvance() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t current = global_epoch_.load(std::memory_order_seq_cst);
+    for (auto& participant : participants_) {
+        if (!participant.in_use.load(std::memory_order_acquire)) {
+            continue;
+        }
+        uint64_t epoch = participant.epoch.load(std::memory_order_acquire);
+        if (epoch != QUIESCENT && epoch != current) {
+            return false;
+        }
+    }
+    return global_epoch_.compare_exchange_strong(current, current + 1);
+}
+
+void EpochManager::Collect() {
+    TryAdvance();
+
+    std::deque<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(mx_retired_);
+        uint64_t current = global_epoch_.load(std::memory_order_seq_cst);
+        // Entries are queued in epoch order, so the expired ones sit at the front
+        while (!retired_.empty() && retired_.front().epoch + 2 <= current) {
+            ready.push_back(std::move(retired_.front()));
+            retired_.pop_front();
+        }
+    }
+
+    for (auto& retired : ready) {
+        retired.deleter();
+    }
+}
\ No newline at end of file
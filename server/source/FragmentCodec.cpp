@@ -0,0 +1,198 @@
+#include "FragmentCodec.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr uint32_t DELTA_HEADER_SIZE = 12;
+constexpr uint8_t ASCENDING = 0;
+constexpr uint8_t DESCENDING = 1;
+
+class BitWriter {
+public:
+    explicit BitWriter(char* out) : out_(reinterpret_cast<uint8_t*>(out)), begin_(out_) {}
+
+    // bits <= 56, so the accumulator never overflows
+    void Put(const uint64_t& value, const uint32_t& bits) {
+        acc_ |= value << filled_;
+        filled_ += bits;
+        while (filled_ >= 8) {
+            *out_++ = static_cast<uint8_t>(acc_);
+            acc_ >>= 8;
+            filled_ -= 8;
+        }
+    }
+
+    uint32_t Finish() {
+        if (filled_ > 0) {
+            *out_++ = static_cast<uint8_t>(acc_);
+        }
+        return out_ - begin_;
+    }
+
+private:
+    uint8_t* out_;
+    uint8_t* begin_;
+    uint64_t acc_ = 0;
+    uint32_t filled_ = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const char* data) : in_(reinterpret_cast<const uint8_t*>(data)) {}
+
+    uint64_t Get(const uint32_t& bits) {
+        while (available_ < bits) {
+            acc_ |= static_cast<uint64_t>(*in_++) << available_;
+            available_ += 8;
+        }
+        uint64_t value = bits == 0 ? 0 : acc_ & (~0ULL >> (64 - bits));
+        acc_ = bits == 64 ? 0 : acc_ >> bits;
+        available_ -= bits;
+        return value;
+    }
+
+private:
+    const uint8_t* in_;
+    uint64_t acc_ = 0;
+    uint32_t available_ = 0;
+};
+
+uint32_t DeltaSize(const uint32_t& count, const uint32_t& width) {
+    return DELTA_HEADER_SIZE + (static_cast<uint64_t>(count - 1) * width + 7) / 8;
+}
+}
+
+uint64_t FragmentCodec::Key(const double& value) {
+    // Negative values get all bits flipped and positive ones the sign bit
+    // set, so keys compare like the values they come from
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    return (bits >> 63) != 0 ? ~bits : bits | (1ULL << 63);
+}
+
+double FragmentCodec::Value(const uint64_t& key) {
+    uint64_t bits = (key >> 63) != 0 ? key & ~(1ULL << 63) : ~key;
+    double value;
+    memcpy(&value, &bits, sizeof(double));
+    return value;
+}
+
+uint32_t FragmentCodec::Encode(const double* values, const uint32_t& count, char* out, FragmentEncoding& encoding) {
+    const uint32_t raw_size = count * sizeof(double);
+    encoding = FragmentEncoding::RAW;
+    if (count < 2 || count > 0xFFFF) {
+        memcpy(out, values, raw_size);
+        return raw_size;
+    }
+
+    // First pass: direction and the widest delta
+    const uint64_t first = Key(values[0]);
+    const uint8_t direction = Key(values[1]) >= first ? ASCENDING : DESCENDING;
+    uint64_t widest = 0;
+    uint64_t previous = first;
+    for (uint32_t i = 1; i < count; ++i) {
+        const uint64_t key = Key(values[i]);
+        const bool in_order = direction == ASCENDING ? key >= previous : key <= previous;
+        if (!in_order) {
+            memcpy(out, values, raw_size);
+            return raw_size;
+        }
+        widest |= direction == ASCENDING ? key - previous : previous - key;
+        previous = key;
+    }
+    const uint32_t width = widest == 0 ? 0 : 64 - __builtin_clzll(widest);
+    if (width > MAX_DELTA_WIDTH || DeltaSize(count, width) >= raw_size) {
+        memcpy(out, values, raw_size);
+        return raw_size;
+    }
+
+    BitWriter writer(out);
+    writer.Put(count, 16);
+    writer.Put(width, 8);
+    writer.Put(direction, 8);
+    writer.Put(first & 0xFFFFFFFF, 32);
+    writer.Put(first >> 32, 32);
+    previous = first;
+    for (uint32_t i = 1; i < count; ++i) {
+        const uint64_t key = Key(values[i]);
+        writer.Put(direction == ASCENDING ? key - previous : previous - key, width);
+        previous = key;
+    }
+    encoding = FragmentEncoding::DELTA;
+    return writer.Finish();
+}
+
+uint32_t FragmentCodec::Decode(const FragmentEncoding& encoding, const char* data, const uint32_t& size, double* out,
+                               const uint32_t& capacity, const double& fixed_scale) {
+    switch (encoding) {
+        case FragmentEncoding::RAW: {
+            const uint32_t count = size / sizeof(double);
+            if (count > capacity || size % sizeof(double) != 0) {
+                return 0;
+            }
+            Wire::LoadArray(data, out, count);
+            return count;
+        }
+        case FragmentEncoding::DELTA: {
+            if (size < DELTA_HEADER_SIZE) {
+                return 0;
+            }
+            BitReader reader(data);
+            const uint32_t count = reader.Get(16);
+            const uint32_t width = reader.Get(8);
+            const uint32_t direction = reader.Get(8);
+            if (count == 0 || count > capacity || width > MAX_DELTA_WIDTH || direction > DESCENDING
+                || DeltaSize(count, width) > size) {
+                return 0;
+            }
+            uint64_t key = reader.Get(32);
+            key |= reader.Get(32) << 32;
+            out[0] = Value(key);
+            for (uint32_t i = 1; i < count; ++i) {
+                const uint64_t delta = reader.Get(width);
+                key = direction == ASCENDING ? key + delta : key - delta;
+                out[i] = Value(key);
+            }
+            return count;
+        }
+        case FragmentEncoding::FLOAT32:
+        case FragmentEncoding::FIXED32: {
+            const uint32_t count = size / sizeof(float);
+            if (count > capacity || size % sizeof(float) != 0) {
+                return 0;
+            }
+            // Both widen exactly: every float is a double, and a 31-bit
+            // multiple of a power of two needs no rounding
+            for (uint32_t i = 0; i < count; ++i) {
+                if (encoding == FragmentEncoding::FLOAT32) {
+                    float item;
+                    Wire::Load(data + i * sizeof(float), item);
+                    out[i] = item;
+                } else {
+                    int32_t item;
+                    Wire::Load(data + i * sizeof(int32_t), item);
+                    out[i] = item * fixed_scale;
+                }
+            }
+            return count;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+uint32_t FragmentCodec::ValueSize(const FragmentEncoding& encoding) {
+    return encoding == FragmentEncoding::FLOAT32 || encoding == FragmentEncoding::FIXED32 ? sizeof(float) : sizeof(double);
+}
+
+uint32_t FragmentCodec::ValueSize(const ValuePrecision& precision) {
+    return precision == ValuePrecision::FLOAT64 ? sizeof(double) : sizeof(float);
+}
+
+double FragmentCodec::FixedScale(const double& range) {
+    int exponent = 0;
+    std::frexp(std::fabs(range), &exponent);
+    return std::ldexp(1.0, exponent - 31);
+}
\ No newline at end of file
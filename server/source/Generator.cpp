@@ -0,0 +1,182 @@
+#include "Generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+constexpr uint32_t MAX_DEDUPE_ROUNDS = 64;
+constexpr uint64_t DEDUPE_STREAM = ~0ULL;
+}
+
+Generator::Generator() {
+    std::random_device rd;
+    seed_state_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+Generator::Generator(const uint64_t& seed) : seed_state_(seed) {}
+
+uint64_t Generator::NextSeed() {
+    // SplitMix64
+    uint64_t z = (seed_state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+bool Generator::GenerateUnique(std::vector<double>& out, const uint32_t& count, const double& min, const double& max) {
+    return GenerateUnique(out, count, min, max, NextSeed());
+}
+
+bool Generator::GenerateUnique(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                               const uint64_t& seed) {
+    if (!(min < max) || !std::isfinite(max - min)) {
+        return false;
+    }
+    if (count == 0) {
+        out.clear();
+        return true;
+    }
+    if (Stratifiable(count, min, max) && Stratified(out, count, min, max, seed, false)) {
+        return true;
+    }
+    return SortDedupe(out, count, min, max, seed);
+}
+
+bool Generator::GenerateStateless(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                                  const uint64_t& seed) {
+    if (!Stratifiable(count, min, max)) {
+        return false;
+    }
+    return Stratified(out, count, min, max, seed, true);
+}
+
+void Generator::Regenerate(double* out, const uint32_t& first, const uint32_t& size, const uint32_t& count,
+                           const double& min, const double& max, const uint64_t& seed) {
+    // Same arithmetic as StratifiedBlocks, so the values match bit for bit
+    const double width = (max - min) / count;
+    Random::FillCounter(out, size, seed, first, 1, min, width);
+    Confine(out, first, size, min, width, std::nextafter(max, min));
+}
+
+void Generator::RegenerateDescending(double* out, const uint32_t& first, const uint32_t& size, const uint32_t& count,
+                                     const double& min, const double& max, const uint64_t& seed) {
+    // Output is ascending by construction, so descending is the mirrored slice
+    Regenerate(out, count - first - size, size, count, min, max, seed);
+    std::reverse(out, out + size);
+}
+
+bool Generator::Stratifiable(const uint32_t& count, const double& min, const double& max) {
+    if (!(min < max) || !std::isfinite(max - min) || count == 0) {
+        return false;
+    }
+    // Strata wider than two steps of the coarsest double in the range have
+    // distinct bounds, which is all Confine needs for strict ordering
+    const double magnitude = std::max(std::fabs(min), std::fabs(max));
+    const double spacing = std::nextafter(magnitude, INFINITY) - magnitude;
+    return (max - min) / count > 2 * spacing;
+}
+
+void Generator::Confine(double* out, const size_t& first, const size_t& size, const double& min, const double& width,
+                        const double& last) {
+    // Rounding is monotone, so a value can only reach the start of the next
+    // stratum, never pass it; pulling it just below keeps values strictly
+    // increasing and depends on nothing but the value's own index
+    for (size_t i = 0; i < size; ++i) {
+        const double bound = min + static_cast<double>(first + i + 1) * width;
+        double value = out[i];
+        if (value >= bound) {
+            value = std::nextafter(bound, min);
+        }
+        out[i] = std::min(value, last);
+    }
+}
+
+bool Generator::Stratified(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                           const uint64_t& seed, const bool& counter_based) {
+    out.resize(count);
+    const size_t blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t threads = 1;
+    if (count >= PARALLEL_THRESHOLD) {
+        threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), blocks);
+    }
+
+    bool ok = true;
+    if (threads == 1) {
+        ok = StratifiedBlocks(out.data(), count, 0, blocks, min, max, seed, counter_based);
+    } else {
+        // Contiguous runs of blocks per thread; each writes a disjoint slice
+        std::vector<std::thread> workers;
+        std::vector<char> results(threads, 1);
+        for (size_t t = 0; t < threads; ++t) {
+            size_t first = blocks * t / threads;
+            size_t last = blocks * (t + 1) / threads;
+            workers.emplace_back([this, &out, &results, t, first, last, count, min, max, seed, counter_based]() {
+                results[t] = StratifiedBlocks(out.data(), count, first, last, min, max, seed, counter_based);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        ok = std::all_of(results.begin(), results.end(), [](const char& result) { return result != 0; });
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Blocks are checked internally; only their seams are left
+    for (size_t b = 1; b < blocks; ++b) {
+        if (out[b * BLOCK_SIZE] <= out[b * BLOCK_SIZE - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Generator::StratifiedBlocks(double* out, const uint32_t& count, const size_t& first_block, const size_t& last_block,
+                                 const double& min, const double& max, const uint64_t& seed, const bool& counter_based) {
+    const double width = (max - min) / count;
+    const double last = std::nextafter(max, min);
+    Random random;
+    for (size_t b = first_block; b < last_block; ++b) {
+        size_t begin = b * BLOCK_SIZE;
+        size_t size = std::min<size_t>(BLOCK_SIZE, count - begin);
+        if (counter_based) {
+            Random::FillCounter(out + begin, size, seed, begin, 1, min, width);
+        } else {
+            random.Seed(seed, b);
+            random.Fill(out + begin, size, static_cast<double>(begin), 1, min, width);
+        }
+        Confine(out + begin, begin, size, min, width, last);
+
+        // Cannot trigger for Stratifiable ranges; kept as a cheap safety net
+        for (size_t i = begin + 1; i < begin + size; ++i) {
+            if (out[i] <= out[i - 1]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Generator::SortDedupe(std::vector<double>& out, const uint32_t& count, const double& min, const double& max,
+                           const uint64_t& seed) {
+    const double width = max - min;
+    Random random;
+    random.Seed(seed, DEDUPE_STREAM);
+    out.clear();
+    out.reserve(count);
+    for (uint32_t round = 0; round < MAX_DEDUPE_ROUNDS && out.size() < count; ++round) {
+        size_t filled = out.size();
+        out.resize(count);
+        random.Fill(out.data() + filled, count - filled, 0, 0, min, width);
+        for (size_t i = filled; i < count; ++i) {
+            out[i] = std::min(out[i], std::nextafter(max, min));
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+    // Give up when the range cannot hold `count` distinct doubles
+    return out.size() == count;
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "Precision.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "FragmentCodec.hpp"
+#include "Generator.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PRECISION_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+// Narrows values[i], whose stratum starts at min + (first + i) * width.
+// `scale` is the inverse fixed-point step and unused for float32
+using NarrowKernel = void (*)(const double* values, size_t size, double first, double min, double width, double scale,
+                              void* out);
+
+float FloorFloat(const double& value) {
+    float item = static_cast<float>(value);
+    if (static_cast<double>(item) > value) {
+        item = std::nextafterf(item, -INFINITY);
+    }
+    return item;
+}
+
+float CeilFloat(const double& value) {
+    float item = static_cast<float>(value);
+    if (static_cast<double>(item) < value) {
+        item = std::nextafterf(item, INFINITY);
+    }
+    return item;
+}
+
+// Items are stored with memcpy since `out` may alias the doubles being read
+void NarrowFloatScalar(const double* values, size_t size, double first, double min, double width, double, void* out) {
+    char* items = static_cast<char*>(out);
+    for (size_t i = 0; i < size; ++i) {
+        const double bound = min + (first + static_cast<double>(i)) * width;
+        const float down = FloorFloat(values[i]);
+        const float up = CeilFloat(bound);
+        const float item = down < up ? up : down;
+        memcpy(items + i * sizeof(float), &item, sizeof(float));
+    }
+}
+
+void NarrowFixedScalar(const double* values, size_t size, double first, double min, double width, double scale, void* out) {
+    char* items = static_cast<char*>(out);
+    for (size_t i = 0; i < size; ++i) {
+        const double bound = min + (first + static_cast<double>(i)) * width;
+        const double down = std::floor(values[i] * scale);
+        const double up = std::ceil(bound * scale);
+        const int32_t item = static_cast<int32_t>(down < up ? up : down);
+        memcpy(items + i * sizeof(int32_t), &item, sizeof(int32_t));
+    }
+}
+
+#ifdef PRECISION_X86_DISPATCH
+// One float step away from zero for positive items and toward it for
+// negative ones, i.e. the next float up; subtracting it steps down
+__attribute__((target("avx2")))
+__m128i StepUp(const __m128 items) {
+    const __m128i bits = _mm_castps_si128(items);
+    const __m128i sign = _mm_srai_epi32(bits, 31);
+    return _mm_or_si128(_mm_add_epi32(sign, sign), _mm_set1_epi32(1));
+}
+
+__attribute__((target("avx2")))
+__m128i Lanes32(const __m256d mask) {
+    const __m256i packed = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(mask), _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+    return _mm256_castsi256_si128(packed);
+}
+
+__attribute__((target("avx2")))
+void NarrowFloatAvx2(const double* values, size_t size, double first, double min, double width, double scale, void* out) {
+    char* items = static_cast<char*>(out);
+    const __m256d min_v = _mm256_set1_pd(min);
+    const __m256d width_v = _mm256_set1_pd(width);
+    const __m256d lanes = _mm256_setr_pd(0, 1, 2, 3);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m256d value = _mm256_loadu_pd(values + i);
+        const __m256d index = _mm256_add_pd(_mm256_set1_pd(first + static_cast<double>(i)), lanes);
+        const __m256d bound = _mm256_add_pd(min_v, _mm256_mul_pd(index, width_v));
+
+        // Round to nearest, then take one step back where that overshot
+        __m128 down = _mm256_cvtpd_ps(value);
+        const __m128i down_over = Lanes32(_mm256_cmp_pd(_mm256_cvtps_pd(down), value, _CMP_GT_OQ));
+        down = _mm_castsi128_ps(_mm_sub_epi32(_mm_castps_si128(down), _mm_and_si128(StepUp(down), down_over)));
+        __m128 up = _mm256_cvtpd_ps(bound);
+        const __m128i up_under = Lanes32(_mm256_cmp_pd(_mm256_cvtps_pd(up), bound, _CMP_LT_OQ));
+        up = _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(up), _mm_and_si128(StepUp(up), up_under)));
+
+        _mm_storeu_ps(reinterpret_cast<float*>(items + i * sizeof(float)), _mm_blendv_ps(down, up, _mm_cmplt_ps(down, up)));
+    }
+    NarrowFloatScalar(values + i, size - i, first + static_cast<double>(i), min, width, scale, items + i * sizeof(float));
+}
+
+__attribute__((target("avx2")))
+void NarrowFixedAvx2(const double* values, size_t size, double first, double min, double width, double scale, void* out) {
+    char* items = static_cast<char*>(out);
+    const __m256d min_v = _mm256_set1_pd(min);
+    const __m256d width_v = _mm256_set1_pd(width);
+    const __m256d scale_v = _mm256_set1_pd(scale);
+    const __m256d lanes = _mm256_setr_pd(0, 1, 2, 3);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m256d value = _mm256_loadu_pd(values + i);
+        const __m256d index = _mm256_add_pd(_mm256_set1_pd(first + static_cast<double>(i)), lanes);
+        const __m256d bound = _mm256_add_pd(min_v, _mm256_mul_pd(index, width_v));
+        const __m256d down = _mm256_floor_pd(_mm256_mul_pd(value, scale_v));
+        const __m256d up = _mm256_ceil_pd(_mm256_mul_pd(bound, scale_v));
+        const __m256d item = _mm256_blendv_pd(down, up, _mm256_cmp_pd(down, up, _CMP_LT_OQ));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(items + i * sizeof(int32_t)), _mm256_cvtpd_epi32(item));
+    }
+    NarrowFixedScalar(values + i, size - i, first + static_cast<double>(i), min, width, scale, items + i * sizeof(int32_t));
+}
+
+__attribute__((target("avx512f")))
+void NarrowFloatAvx512(const double* values, size_t size, double first, double min, double width, double scale, void* out) {
+    char* items = static_cast<char*>(out);
+    const __m512d min_v = _mm512_set1_pd(min);
+    const __m512d width_v = _mm512_set1_pd(width);
+    const __m512d lanes = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m512d value = _mm512_loadu_pd(values + i);
+        const __m512d index = _mm512_add_pd(_mm512_set1_pd(first + static_cast<double>(i)), lanes);
+        const __m512d bound = _mm512_add_pd(min_v, _mm512_mul_pd(index, width_v));
+        const __m256 down = _mm512_cvt_roundpd_ps(value, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        const __m256 up = _mm512_cvt_roundpd_ps(bound, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+        _mm256_storeu_ps(reinterpret_cast<float*>(items + i * sizeof(float)),
+                         _mm256_blendv_ps(down, up, _mm256_cmp_ps(down, up, _CMP_LT_OQ)));
+    }
+    NarrowFloatScalar(values + i, size - i, first + static_cast<double>(i), min, width, scale, items + i * sizeof(float));
+}
+
+__attribute__((target("avx512f")))
+void NarrowFixedAvx512(const double* values, size_t size, double first, double min, double width, double scale, void* out) {
+    char* items = static_cast<char*>(out);
+    const __m512d min_v = _mm512_set1_pd(min);
+    const __m512d width_v = _mm512_set1_pd(width);
+    const __m512d scale_v = _mm512_set1_pd(scale);
+    const __m512d lanes = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m512d value = _mm512_loadu_pd(values + i);
+        const __m512d index = _mm512_add_pd(_mm512_set1_pd(first + static_cast<double>(i)), lanes);
+        const __m512d bound = _mm512_add_pd(min_v, _mm512_mul_pd(index, width_v));
+        const __m512d down = _mm512_roundscale_pd(_mm512_mul_pd(value, scale_v), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        const __m512d up = _mm512_roundscale_pd(_mm512_mul_pd(bound, scale_v), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+        const __m512d item = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(down, up, _CMP_LT_OQ), down, up);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(items + i * sizeof(int32_t)), _mm512_cvtpd_epi32(item));
+    }
+    NarrowFixedScalar(values + i, size - i, first + static_cast<double>(i), min, width, scale, items + i * sizeof(int32_t));
+}
+#endif
+
+struct Dispatch {
+    NarrowKernel narrow_float;
+    NarrowKernel narrow_fixed;
+    const char* name;
+};
+
+Dispatch Select() {
+#ifdef PRECISION_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Dispatch{NarrowFloatAvx512, NarrowFixedAvx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Dispatch{NarrowFloatAvx2, NarrowFixedAvx2, "avx2"};
+    }
+#endif
+    return Dispatch{NarrowFloatScalar, NarrowFixedScalar, "scalar"};
+}
+
+const Dispatch& Selected() {
+    static const Dispatch dispatch = Select();
+    return dispatch;
+}
+}
+
+bool Precision::Representable(const ValuePrecision& precision, const uint32_t& count, const double& min, const double& max) {
+    if (!Generator::Stratifiable(count, min, max)) {
+        return false;
+    }
+    // Like Stratifiable, but against the coarsest step of the target grid
+    const double magnitude = std::max(std::fabs(min), std::fabs(max));
+    double step = 0;
+    switch (precision) {
+        case ValuePrecision::FLOAT64: {
+            return true;
+        }
+        case ValuePrecision::FLOAT32: {
+            if (magnitude > FLT_MAX) {
+                return false;
+            }
+            const float top = static_cast<float>(magnitude);
+            step = static_cast<double>(std::nextafterf(top, INFINITY)) - top;
+            break;
+        }
+        case ValuePrecision::FIXED32: {
+            step = FragmentCodec::FixedScale(magnitude);
+            // Narrowing scales by the inverse step, which must stay finite
+            if (!std::isfinite(1 / step)) {
+                return false;
+            }
+            break;
+        }
+        default: {
+            return false;
+        }
+    }
+    return (max - min) / count > 2 * step;
+}
+
+void Precision::Narrow(const ValuePrecision& precision, const double* values, const uint32_t& first, const uint32_t& size,
+                       const uint32_t& count, const double& min, const double& max, void* out) {
+    // Same stratum bounds as Generator::Confine
+    const double width = (max - min) / count;
+    if (precision == ValuePrecision::FLOAT32) {
+        Selected().narrow_float(values, size, first, min, width, 0, out);
+    } else if (precision == ValuePrecision::FIXED32) {
+        // The step is a power of two, so scaling by its inverse is exact
+        const double scale = 1 / FragmentCodec::FixedScale(std::max(std::fabs(min), std::fabs(max)));
+        Selected().narrow_fixed(values, size, first, min, width, scale, out);
+    }
+}
+
+size_t Precision::Regenerate(const ValuePrecision& precision, const bool& descending, void* out, const uint32_t& first,
+                             const uint32_t& size, const uint32_t& count, const double& min, const double& max,
+                             const uint64_t& seed) {
+    double* values = static_cast<double*>(out);
+    if (precision == ValuePrecision::FLOAT64) {
+        if (descending) {
+            Generator::RegenerateDescending(values, first, size, count, min, max, seed);
+        } else {
+            Generator::Regenerate(values, first, size, count, min, max, seed);
+        }
+        return size * sizeof(double);
+    }
+
+    // Narrowing needs each value's stratum, so convert the ascending slice
+    // and mirror it afterwards
+    const uint32_t ascending_first = descending ? count - first - size : first;
+    Generator::Regenerate(values, ascending_first, size, count, min, max, seed);
+    Narrow(precision, values, ascending_first, size, count, min, max, out);
+    if (descending) {
+        Reverse(precision, out, size);
+    }
+    return size * FragmentCodec::ValueSize(precision);
+}
+
+void Precision::Reverse(const ValuePrecision& precision, void* values, const size_t& size) {
+    if (FragmentCodec::ValueSize(precision) == sizeof(double)) {
+        std::reverse(static_cast<double*>(values), static_cast<double*>(values) + size);
+    } else {
+        std::reverse(static_cast<uint32_t*>(values), static_cast<uint32_t*>(values) + size);
+    }
+}
+
+const char* Precision::KernelName() {
+    return Selected().name;
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "Query.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUERY_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr size_t LANES = 8;
+using SumKernel = void (*)(const double* values, size_t blocks, double* partial);
+
+// Every kernel adds value j of each group of LANES into partial[j]
+void SumScalar(const double* values, size_t blocks, double* partial) {
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t j = 0; j < LANES; ++j) {
+            partial[j] += values[b * LANES + j];
+        }
+    }
+}
+
+#ifdef QUERY_X86_DISPATCH
+__attribute__((target("sse2")))
+void SumSse2(const double* values, size_t blocks, double* partial) {
+    __m128d s0 = _mm_loadu_pd(partial);
+    __m128d s1 = _mm_loadu_pd(partial + 2);
+    __m128d s2 = _mm_loadu_pd(partial + 4);
+    __m128d s3 = _mm_loadu_pd(partial + 6);
+    for (size_t b = 0; b < blocks; ++b) {
+        const double* group = values + b * LANES;
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(group));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(group + 2));
+        s2 = _mm_add_pd(s2, _mm_loadu_pd(group + 4));
+        s3 = _mm_add_pd(s3, _mm_loadu_pd(group + 6));
+    }
+    _mm_storeu_pd(partial, s0);
+    _mm_storeu_pd(partial + 2, s1);
+    _mm_storeu_pd(partial + 4, s2);
+    _mm_storeu_pd(partial + 6, s3);
+}
+
+__attribute__((target("avx2")))
+void SumAvx2(const double* values, size_t blocks, double* partial) {
+    __m256d s0 = _mm256_loadu_pd(partial);
+    __m256d s1 = _mm256_loadu_pd(partial + 4);
+    for (size_t b = 0; b < blocks; ++b) {
+        const double* group = values + b * LANES;
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(group));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(group + 4));
+    }
+    _mm256_storeu_pd(partial, s0);
+    _mm256_storeu_pd(partial + 4, s1);
+}
+
+__attribute__((target("avx512f")))
+void SumAvx512(const double* values, size_t blocks, double* partial) {
+    __m512d s = _mm512_loadu_pd(partial);
+    for (size_t b = 0; b < blocks; ++b) {
+        s = _mm512_add_pd(s, _mm512_loadu_pd(values + b * LANES));
+    }
+    _mm512_storeu_pd(partial, s);
+}
+#endif
+
+struct Dispatch {
+    SumKernel kernel;
+    const char* name;
+};
+
+Dispatch Select() {
+#ifdef QUERY_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Dispatch{SumAvx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Dispatch{SumAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Dispatch{SumSse2, "sse2"};
+    }
+#endif
+    return Dispatch{SumScalar, "scalar"};
+}
+
+const Dispatch& Selected() {
+    static const Dispatch dispatch = Select();
+    return dispatch;
+}
+}
+
+double Query::Sum(const double* values, const size_t& count) {
+    double partial[LANES] = {0, 0, 0, 0, 0, 0, 0, 0};
+    const size_t blocks = count / LANES;
+    Selected().kernel(values, blocks, partial);
+    for (size_t i = blocks * LANES; i < count; ++i) {
+        partial[i % LANES] += values[i];
+    }
+    // Fixed pairwise combination keeps the result independent of the kernel
+    return ((partial[0] + partial[1]) + (partial[2] + partial[3])) + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+}
+
+void Query::TopK(const double* values, const size_t& count, const uint32_t& k, std::vector<double>& out) {
+    const size_t size = std::min<size_t>(k, count);
+    out.assign(std::reverse_iterator<const double*>(values + count),
+               std::reverse_iterator<const double*>(values + count - size));
+}
+
+void Query::Quantiles(const double* values, const size_t& count, const uint32_t& intervals, std::vector<double>& out) {
+    // Exact order statistics at ranks 0, 1/intervals, ..., 1 (nearest rank)
+    out.clear();
+    if (count == 0 || intervals == 0) {
+        return;
+    }
+    out.reserve(intervals + 1);
+    for (uint32_t i = 0; i <= intervals; ++i) {
+        size_t rank = static_cast<size_t>((static_cast<double>(count - 1) * i) / intervals + 0.5);
+        out.push_back(values[std::min(rank, count - 1)]);
+    }
+}
+
+void Query::Histogram(const double* values, const size_t& count, const double& min, const double& max,
+                      const uint32_t& bins, std::vector<uint32_t>& out) {
+    // Bin b covers [min + b * width, min + (b + 1) * width); in sorted input
+    // each edge is one binary search
+    out.assign(bins, 0);
+    if (bins == 0) {
+        return;
+    }
+    const double width = (max - min) / bins;
+    const double* end = values + count;
+    const double* lower = std::lower_bound(values, end, min);
+    for (uint32_t b = 0; b < bins; ++b) {
+        const double* upper = b + 1 == bins ? std::lower_bound(lower, end, max)
+                                            : std::lower_bound(lower, end, min + (b + 1) * width);
+        out[b] = static_cast<uint32_t>(upper - lower);
+        lower = upper;
+    }
+}
+
+const char* Query::KernelName() {
+    return Selected().name;
+}
\ No newline at end of file
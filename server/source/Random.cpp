@@ -0,0 +1,277 @@
+#include "Random.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RANDOM_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+using State = uint64_t[4][Random::LANES];
+using Kernel = void (*)(State& s, double* out, size_t blocks, double index, double step, double origin, double width);
+
+constexpr uint64_t ONE_EXPONENT = 0x3FF0000000000000ULL;
+
+uint64_t SplitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t Rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+inline double ToUnit(const uint64_t x) {
+    uint64_t bits = (x >> 12) | ONE_EXPONENT;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value - 1.0;
+}
+
+// Every kernel writes `blocks` groups of LANES values, lane j of a group going
+// to out[j]. Arithmetic is spelled out as separate mul/add steps so the result
+// does not depend on the instruction set (the build disables FP contraction).
+void FillScalar(State& s, double* out, size_t blocks, double index, double step, double origin, double width) {
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t j = 0; j < Random::LANES; ++j) {
+            uint64_t s1 = s[1][j];
+            uint64_t result = Rotl(s1 * 5, 7) * 9;
+            uint64_t t = s1 << 17;
+            s[2][j] ^= s[0][j];
+            s[3][j] ^= s1;
+            s[1][j] ^= s[2][j];
+            s[0][j] ^= s[3][j];
+            s[2][j] ^= t;
+            s[3][j] = Rotl(s[3][j], 45);
+
+            double position = (index + j) * step;
+            out[j] = origin + (position + ToUnit(result)) * width;
+        }
+        out += Random::LANES;
+        index += Random::LANES;
+    }
+}
+
+#ifdef RANDOM_X86_DISPATCH
+// SSE2 and AVX2 have no 64-bit multiply; x * 5 and x * 9 become shift + add
+__attribute__((target("sse2")))
+void FillSse2(State& s, double* out, size_t blocks, double index, double step, double origin, double width) {
+    constexpr size_t VECTORS = Random::LANES / 2;
+    __m128i s0[VECTORS], s1[VECTORS], s2[VECTORS], s3[VECTORS];
+    __m128d idx[VECTORS];
+    for (size_t v = 0; v < VECTORS; ++v) {
+        s0[v] = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[0][v * 2]));
+        s1[v] = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[1][v * 2]));
+        s2[v] = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[2][v * 2]));
+        s3[v] = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[3][v * 2]));
+        idx[v] = _mm_set_pd(index + v * 2 + 1, index + v * 2);
+    }
+    const __m128i exponent = _mm_set1_epi64x(ONE_EXPONENT);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d advance = _mm_set1_pd(static_cast<double>(Random::LANES));
+    const __m128d step_v = _mm_set1_pd(step);
+    const __m128d origin_v = _mm_set1_pd(origin);
+    const __m128d width_v = _mm_set1_pd(width);
+
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t v = 0; v < VECTORS; ++v) {
+            __m128i x = _mm_add_epi64(_mm_slli_epi64(s1[v], 2), s1[v]);
+            x = _mm_or_si128(_mm_slli_epi64(x, 7), _mm_srli_epi64(x, 57));
+            __m128i result = _mm_add_epi64(_mm_slli_epi64(x, 3), x);
+            __m128i t = _mm_slli_epi64(s1[v], 17);
+            s2[v] = _mm_xor_si128(s2[v], s0[v]);
+            s3[v] = _mm_xor_si128(s3[v], s1[v]);
+            s1[v] = _mm_xor_si128(s1[v], s2[v]);
+            s0[v] = _mm_xor_si128(s0[v], s3[v]);
+            s2[v] = _mm_xor_si128(s2[v], t);
+            s3[v] = _mm_or_si128(_mm_slli_epi64(s3[v], 45), _mm_srli_epi64(s3[v], 19));
+
+            __m128d u = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(result, 12), exponent)), one);
+            __m128d value = _mm_add_pd(_mm_mul_pd(idx[v], step_v), u);
+            value = _mm_add_pd(origin_v, _mm_mul_pd(value, width_v));
+            _mm_storeu_pd(out + v * 2, value);
+            idx[v] = _mm_add_pd(idx[v], advance);
+        }
+        out += Random::LANES;
+    }
+
+    for (size_t v = 0; v < VECTORS; ++v) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[0][v * 2]), s0[v]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[1][v * 2]), s1[v]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[2][v * 2]), s2[v]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[3][v * 2]), s3[v]);
+    }
+}
+
+__attribute__((target("avx2")))
+void FillAvx2(State& s, double* out, size_t blocks, double index, double step, double origin, double width) {
+    constexpr size_t VECTORS = Random::LANES / 4;
+    __m256i s0[VECTORS], s1[VECTORS], s2[VECTORS], s3[VECTORS];
+    __m256d idx[VECTORS];
+    for (size_t v = 0; v < VECTORS; ++v) {
+        s0[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[0][v * 4]));
+        s1[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[1][v * 4]));
+        s2[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[2][v * 4]));
+        s3[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&s[3][v * 4]));
+        idx[v] = _mm256_set_pd(index + v * 4 + 3, index + v * 4 + 2, index + v * 4 + 1, index + v * 4);
+    }
+    const __m256i exponent = _mm256_set1_epi64x(ONE_EXPONENT);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d advance = _mm256_set1_pd(static_cast<double>(Random::LANES));
+    const __m256d step_v = _mm256_set1_pd(step);
+    const __m256d origin_v = _mm256_set1_pd(origin);
+    const __m256d width_v = _mm256_set1_pd(width);
+
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t v = 0; v < VECTORS; ++v) {
+            __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1[v], 2), s1[v]);
+            x = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+            __m256i result = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+            __m256i t = _mm256_slli_epi64(s1[v], 17);
+            s2[v] = _mm256_xor_si256(s2[v], s0[v]);
+            s3[v] = _mm256_xor_si256(s3[v], s1[v]);
+            s1[v] = _mm256_xor_si256(s1[v], s2[v]);
+            s0[v] = _mm256_xor_si256(s0[v], s3[v]);
+            s2[v] = _mm256_xor_si256(s2[v], t);
+            s3[v] = _mm256_or_si256(_mm256_slli_epi64(s3[v], 45), _mm256_srli_epi64(s3[v], 19));
+
+            __m256d u = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(result, 12), exponent)), one);
+            __m256d value = _mm256_add_pd(_mm256_mul_pd(idx[v], step_v), u);
+            value = _mm256_add_pd(origin_v, _mm256_mul_pd(value, width_v));
+            _mm256_storeu_pd(out + v * 4, value);
+            idx[v] = _mm256_add_pd(idx[v], advance);
+        }
+        out += Random::LANES;
+    }
+
+    for (size_t v = 0; v < VECTORS; ++v) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[0][v * 4]), s0[v]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[1][v * 4]), s1[v]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[2][v * 4]), s2[v]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&s[3][v * 4]), s3[v]);
+    }
+}
+
+__attribute__((target("avx512f")))
+void FillAvx512(State& s, double* out, size_t blocks, double index, double step, double origin, double width) {
+    __m512i s0 = _mm512_load_si512(&s[0][0]);
+    __m512i s1 = _mm512_load_si512(&s[1][0]);
+    __m512i s2 = _mm512_load_si512(&s[2][0]);
+    __m512i s3 = _mm512_load_si512(&s[3][0]);
+    __m512d idx = _mm512_add_pd(_mm512_set1_pd(index), _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0));
+    const __m512i exponent = _mm512_set1_epi64(ONE_EXPONENT);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d advance = _mm512_set1_pd(static_cast<double>(Random::LANES));
+    const __m512d step_v = _mm512_set1_pd(step);
+    const __m512d origin_v = _mm512_set1_pd(origin);
+    const __m512d width_v = _mm512_set1_pd(width);
+
+    for (size_t b = 0; b < blocks; ++b) {
+        __m512i x = _mm512_add_epi64(_mm512_slli_epi64(s1, 2), s1);
+        x = _mm512_rol_epi64(x, 7);
+        __m512i result = _mm512_add_epi64(_mm512_slli_epi64(x, 3), x);
+        __m512i t = _mm512_slli_epi64(s1, 17);
+        s2 = _mm512_xor_si512(s2, s0);
+        s3 = _mm512_xor_si512(s3, s1);
+        s1 = _mm512_xor_si512(s1, s2);
+        s0 = _mm512_xor_si512(s0, s3);
+        s2 = _mm512_xor_si512(s2, t);
+        s3 = _mm512_rol_epi64(s3, 45);
+
+        __m512d u = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(result, 12), exponent)), one);
+        __m512d value = _mm512_add_pd(_mm512_mul_pd(idx, step_v), u);
+        value = _mm512_add_pd(origin_v, _mm512_mul_pd(value, width_v));
+        _mm512_storeu_pd(out, value);
+        idx = _mm512_add_pd(idx, advance);
+        out += Random::LANES;
+    }
+
+    _mm512_store_si512(&s[0][0], s0);
+    _mm512_store_si512(&s[1][0], s1);
+    _mm512_store_si512(&s[2][0], s2);
+    _mm512_store_si512(&s[3][0], s3);
+}
+#endif
+
+struct Dispatch {
+    Kernel kernel;
+    const char* name;
+};
+
+Dispatch Select() {
+#ifdef RANDOM_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Dispatch{FillAvx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Dispatch{FillAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Dispatch{FillSse2, "sse2"};
+    }
+#endif
+    return Dispatch{FillScalar, "scalar"};
+}
+
+const Dispatch& Selected() {
+    static const Dispatch dispatch = Select();
+    return dispatch;
+}
+}
+
+Random::Random() : Random(0) {}
+
+Random::Random(const uint64_t& seed) {
+    Seed(seed);
+}
+
+void Random::Seed(const uint64_t& seed) {
+    uint64_t x = seed;
+    for (size_t j = 0; j < LANES; ++j) {
+        for (size_t word = 0; word < 4; ++word) {
+            state_[word][j] = SplitMix64(x);
+        }
+    }
+}
+
+void Random::Seed(const uint64_t& seed, const uint64_t& stream) {
+    // Mix the stream id first; plain seed + stream would hand neighbouring
+    // blocks shifted copies of the same SplitMix64 sequence
+    uint64_t x = stream;
+    Seed(seed ^ SplitMix64(x));
+}
+
+void Random::Fill(double* out, const size_t& count, const double& first_index, const double& index_step,
+                  const double& origin, const double& width) {
+    size_t blocks = count / LANES;
+    if (blocks > 0) {
+        Selected().kernel(state_, out, blocks, first_index, index_step, origin, width);
+    }
+
+    // A partial group is generated whole and cut; the unused lanes are dropped
+    size_t done = blocks * LANES;
+    if (done < count) {
+        double tail[LANES];
+        Selected().kernel(state_, tail, 1, first_index + done, index_step, origin, width);
+        std::memcpy(out + done, tail, (count - done) * sizeof(double));
+    }
+}
+
+void Random::FillCounter(double* out, const size_t& count, const uint64_t& seed, const uint64_t& first_index,
+                         const double& index_step, const double& origin, const double& width) {
+    // SplitMix64 is itself counter based: output i is a bijective mix of
+    // seed + (i + 1) * gamma
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t x = seed + (first_index + i) * 0x9E3779B97F4A7C15ULL;
+        double position = static_cast<double>(first_index + i) * index_step;
+        out[i] = origin + (position + ToUnit(SplitMix64(x))) * width;
+    }
+}
+
+const char* Random::KernelName() {
+    return Selected().name;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "ResponseStreamer.hpp"
+
+#include <algorithm>
+
+#include "Constants.hpp"
+#include "Crc32c.hpp"
+#include "FragmentCodec.hpp"
+#include "Precision.hpp"
+#include "Protocol.hpp"
+
+namespace {
+// Sized for STREAM_CHUNK_PACKETS fragments of the default packet size;
+// sessions with other sizes fit as many whole fragments as they can
+constexpr uint32_t VALUES_PER_CHUNK = (DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE) / sizeof(double) * STREAM_CHUNK_PACKETS;
+}
+
+ResponseStreamer::ResponseStreamer() {}
+
+ResponseStreamer::~ResponseStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mx_streamer_);
+        stop_ = true;
+    }
+    cv_streamer_.notify_all();
+    if (producer_.joinable()) {
+        producer_.join();
+    }
+}
+
+void ResponseStreamer::Start(Sink sink) {
+    sink_ = std::move(sink);
+    ring_.reset(new double[static_cast<size_t>(VALUES_PER_CHUNK) * STREAM_RING_CHUNKS]);
+    for (uint32_t slot = 0; slot < STREAM_RING_CHUNKS; ++slot) {
+        free_slots_.push_back(slot);
+    }
+    producer_ = std::thread([this]() { Produce(); });
+}
+
+void ResponseStreamer::Submit(const StreamJob& job) {
+    std::lock_guard<std::mutex> lock(mx_streamer_);
+    jobs_.push_back(job);
+    cv_streamer_.notify_all();
+}
+
+uint32_t ResponseStreamer::AcquireSlot(std::unique_lock<std::mutex>& lock) {
+    cv_streamer_.wait(lock, [this]() { return stop_ || !free_slots_.empty(); });
+    if (stop_) {
+        return STREAM_RING_CHUNKS;
+    }
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+}
+
+void ResponseStreamer::ReleaseSlot(const uint32_t& slot) {
+    std::lock_guard<std::mutex> lock(mx_streamer_);
+    free_slots_.push_back(slot);
+    cv_streamer_.notify_all();
+}
+
+void ResponseStreamer::Produce() {
+    std::unique_lock<std::mutex> lock(mx_streamer_);
+    while (true) {
+        cv_streamer_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (stop_) {
+            return;
+        }
+        uint32_t slot = AcquireSlot(lock);
+        if (slot == STREAM_RING_CHUNKS) {
+            return;
+        }
+        StreamJob job = jobs_.front();
+        jobs_.pop_front();
+        lock.unlock();
+
+        // A chunk holds at most VALUES_PER_CHUNK values, which take fewer
+        // fragments when they are narrowed
+        const uint32_t packet_data_size = job.packet_data_size;
+        const uint32_t value_size = FragmentCodec::ValueSize(job.precision);
+        const uint32_t values_per_packet = packet_data_size / value_size;
+        const uint32_t packets_total = (static_cast<uint64_t>(job.count) * value_size + packet_data_size - 1) / packet_data_size;
+        const uint32_t packets = std::min(VALUES_PER_CHUNK / values_per_packet, packets_total - job.next_packet + 1);
+        const uint32_t first_value = (job.next_packet - 1) * values_per_packet;
+        const uint32_t values = std::min(packets * values_per_packet, job.count - first_value);
+        double* chunk = ring_.get() + static_cast<size_t>(slot) * VALUES_PER_CHUNK;
+        const size_t bytes = Precision::Regenerate(job.precision, job.descending, chunk, first_value, values, job.count,
+                                                   job.min, job.max, job.seed);
+
+        if (job.checksums) {
+            job.digest = Crc32c::Extend(job.digest, chunk, bytes);
+        }
+
+        // The slot goes back to the ring once the sender drops the chunk
+        std::shared_ptr<const void> owner(chunk, [this, slot](const void*) { ReleaseSlot(slot); });
+        const uint32_t first_packet = job.next_packet;
+        job.next_packet += packets;
+        const bool last = job.next_packet > packets_total;
+        sink_(job, Buffer::Share(std::move(owner), chunk, bytes), first_packet, packets, last);
+
+        lock.lock();
+        if (!last) {
+            jobs_.push_back(job);
+        }
+    }
+}
\ No newline at end of file
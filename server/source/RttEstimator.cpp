@@ -0,0 +1,54 @@
+#include "RttEstimator.hpp"
+
+#include <algorithm>
+
+#include "Constants.hpp"
+
+RttEstimator::RttEstimator()
+    : srtt_(0)
+    , rttvar_(0)
+    , has_sample_(false) {}
+
+void RttEstimator::AddSample(const Duration& sample) {
+    if (!has_sample_) {
+        srtt_ = sample;
+        rttvar_ = sample / 2;
+        has_sample_ = true;
+        return;
+    }
+    Duration delta = srtt_ > sample ? srtt_ - sample : sample - srtt_;
+    rttvar_ = (rttvar_ * 3 + delta) / 4;
+    srtt_ = (srtt_ * 7 + sample) / 8;
+}
+
+bool RttEstimator::HasSample() const {
+    return has_sample_;
+}
+
+RttEstimator::Duration RttEstimator::Srtt() const {
+    return srtt_;
+}
+
+RttEstimator::Duration RttEstimator::Rto() const {
+    if (!has_sample_) {
+        return std::chrono::milliseconds(INITIAL_RTO_MS);
+    }
+    Duration rto = srtt_ + std::max<Duration>(std::chrono::milliseconds(1), rttvar_ * 4);
+    return std::clamp<Duration>(rto, std::chrono::milliseconds(MIN_RTO_MS), std::chrono::milliseconds(MAX_RTO_MS));
+}
+
+RttEstimator::Duration RttEstimator::ProbeTimeout() const {
+    if (!has_sample_) {
+        return Rto();
+    }
+    return std::clamp<Duration>(srtt_ * 2, std::chrono::milliseconds(MIN_PROBE_TIMEOUT_MS), Rto());
+}
+
+RttEstimator::Duration RttEstimator::Backoff(const uint32_t& attempt) const {
+    // Exponential backoff on the RTO, capped at MAX_RTO_MS
+    Duration rto = Rto();
+    for (uint32_t i = 0; i < attempt && rto < std::chrono::milliseconds(MAX_RTO_MS); ++i) {
+        rto *= 2;
+    }
+    return std::min<Duration>(rto, std::chrono::milliseconds(MAX_RTO_MS));
+}
\ No newline at end of file
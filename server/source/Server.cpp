@@ -1,13 +1,28 @@
 #include "Server.hpp"
 
+// RESPONSE payloads go out straight from the dataset buffers, so their host
+// layout has to be the little-endian wire layout
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The server requires a little-endian host"
+#endif
+
 Server::Server(const std::string& path)
     : reader_(path)
     , sockfd(0)
-    , client_handler_(256)
     , logger_("logs.txt") {
     ReadConfigs();
-    StartServer();
+    client_handler_.Initialize(server_conf_.max_clients);
     std::cout << "Max threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << "Random kernel: " << Random::KernelName() << "\n";
+    std::cout << "CRC32C kernel: " << Crc32c::KernelName() << "\n";
+    pool_.Start(protocol_conf_.values_amount, server_conf_.pool_values, server_conf_.pool_depth,
+                static_cast<size_t>(server_conf_.pool_memory_limit_mb) << 20, server_conf_.stateless_datasets);
+    if (server_conf_.streaming_responses) {
+        streamer_.Start([this](const StreamJob& job, Buffer chunk, const uint32_t& first_packet, const uint32_t& packets, const bool& last) {
+            QueueChunk(job, std::move(chunk), first_packet, packets, last);
+        });
+    }
+    StartServer();
 }
 
 bool Server::Initialize() {
@@ -66,129 +81,566 @@ bool Server::Initialize() {
 void Server::Run() {
     logger_.Log(__func__);
     Packet packet;
-    ProtocolHeader* header;
+    auto on_timer = [this](const uint8_t& kind, const uint64_t& context) {
+        OnTimer(static_cast<TimerKind>(kind), context);
+    };
+    std::deque<std::function<void()>> tasks;
     while (true) {
+        bool has_packet = false;
         {
-            std::unique_lock<std::mutex> lock(mx_deque_sending_data_);
-            cv_recv.wait(lock, [this](){ return !packets_.empty();});
-            packet = packets_[0];
-            packets_.pop_front();
-        }
-
-        header = reinterpret_cast<ProtocolHeader*>(packet.buffer);
-        switch(header->type) {
-            case MessageType::REQUEST: {
-                ProcessRequest(packet.client_addr, packet.buffer, packet.buffer_size);
-                break;
-            }
-            case MessageType::ACKNOWLEDGE: {
-                ProcessAcknowledge(packet.client_addr, packet.buffer, packet.buffer_size);
-                break;
-            }
-            case MessageType::ERROR_CODE: {
-                std::cout << "Error\n";
-                break;
-            }
-            case MessageType::RESPONSE: {
-                std::cout << "Unexpected packet type\n";
-                break;
-            }
-            case MessageType::MISSED_PACKETS: {
-                std::cout << "Got missed packets\n";
-                ProcessMissedPackets(packet.client_addr, packet.buffer, packet.buffer_size);
-                break;
-            }
-            case MessageType::CONNECT: {
-                std::cout << "Connection request\n";
-                ProcessConnect(packet.client_addr, packet.buffer, packet.buffer_size);
-                break;
+            std::unique_lock<std::mutex> lock(mx_deque_packets_);
+            auto ready = [this](){ return !packets_.empty() || !tasks_.empty();};
+            if (timers_.Empty()) {
+                cv_recv.wait(lock, ready);
+            } else {
+                cv_recv.wait_until(lock, timers_.NextExpiry(), ready);
             }
-            default: {
-                break;
+            if (!packets_.empty()) {
+                packet = packets_[0];
+                packets_.pop_front();
+                has_packet = true;
             }
+            tasks.swap(tasks_);
         }
+
+        for (auto& task : tasks) {
+            task();
+        }
+        tasks.clear();
+
+        timers_.Advance(TimerWheel::Clock::now(), on_timer);
+        QueueMessages(stream_sends_);
+        client_handler_.GetEpoch().Collect();
+        if (!has_packet) {
+            continue;
+        }
+
+        Dispatch(packet.client_addr, packet.buffer, packet.buffer_size);
         delete[] packet.buffer;
     }
 }
 
+void Server::Dispatch(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    switch(WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::type>()) {
+        case MessageType::REQUEST: {
+            ProcessRequest(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::ACKNOWLEDGE: {
+            ProcessAcknowledge(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::ERROR_CODE: {
+            std::cout << "Error\n";
+            break;
+        }
+        case MessageType::RESPONSE: {
+            std::cout << "Unexpected packet type\n";
+            break;
+        }
+        case MessageType::MISSED_PACKETS: {
+            std::cout << "Got missed packets\n";
+            ProcessMissedPackets(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::CONNECT: {
+            std::cout << "Connection request\n";
+            ProcessConnect(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::QUERY: {
+            ProcessQuery(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::BATCH_REQUEST: {
+            ProcessBatchRequest(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::CUMULATIVE_ACK: {
+            ProcessCumulativeAck(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::SUBSCRIBE: {
+            ProcessSubscribe(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::UNSUBSCRIBE: {
+            ProcessUnsubscribe(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::STREAM_REPORT: {
+            ProcessStreamReport(client_addr, buffer, buffer_size);
+            break;
+        }
+        case MessageType::BUNDLE: {
+            ProcessBundle(client_addr, buffer, buffer_size);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+void Server::ProcessBundle(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    // Every message is handled as if it came alone; replies to the same peer
+    // are bundled again on the way out
+    BundleReader reader(buffer, buffer_size);
+    size_t offset = 0;
+    size_t size = 0;
+    holding_replies_ = true;
+    while (reader.Next(offset, size)) {
+        Dispatch(client_addr, buffer + offset, size);
+    }
+    holding_replies_ = false;
+    QueueMessages(held_replies_);
+    if (reader.Malformed()) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+    }
+}
+
 void Server::ProcessMissedPackets(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
     logger_.Log(__func__);
-    ProtocolHeader* p_header = reinterpret_cast<ProtocolHeader*>(buffer);
-    MissedPacketsHeader* m_header = reinterpret_cast<MissedPacketsHeader*>(buffer + sizeof(ProtocolHeader));
-    uint32_t packet_data_size = MAX_PACKET_SIZE - sizeof(ProtocolHeader);
-    Client client = client_handler_.GetClient(m_header->client_id);
-
-    char* m_buffer = new char[m_header->total_packets_missed * packet_data_size];
-    uint16_t packet_number = 0;
-    uint32_t offset = 0;
-    uint32_t data_offset = 0;
-    uint32_t copy_amount = packet_data_size;
-    uint16_t* packet_numbers = new uint16_t[m_header->total_packets_missed];
-    for(uint32_t i = 0; i < m_header->total_packets_missed; ++i) {
-        memcpy(&packet_number, buffer + sizeof(ProtocolHeader) + sizeof(MissedPacketsHeader) + (offset * sizeof(uint16_t)), sizeof(uint16_t));
-        packet_numbers[i] = packet_number;
-        ++offset;
-        if (packet_number * packet_data_size > client.data_size) {
-            copy_amount = client.data_size - (packet_number - 1) * packet_data_size;
-        }
-        memcpy(m_buffer + data_offset, client.data.data() + ((packet_number - 1) * packet_data_size), copy_amount);
-        data_offset += packet_data_size;
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<MissedPacketsHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    WireView<MissedPacketsHeader> m_header(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(m_header.Get<&MissedPacketsHeader::client_id>(), client_addr);
+    Dataset* dataset = client != nullptr ? client->dataset.load(std::memory_order_acquire) : nullptr;
+    if (dataset == nullptr) {
+        SendError(client_addr, ErrorCode::INVALID_SESSION);
+        return;
+    }
+    TouchClient(*client);
+
+    // The client is alive and asking; restart probing after this resend
+    timers_.Cancel(client->retransmit_timer);
+    client->probes_sent = 0;
+    client->retransmitted = true;
+
+    uint32_t count = std::min<uint32_t>(m_header.Get<&MissedPacketsHeader::total_packets_missed>(),
+                                        (buffer_size - PROTOCOL_HEADER_SIZE - WireCodec<MissedPacketsHeader>::SIZE) / sizeof(uint16_t));
+    std::vector<uint16_t> missed(count);
+    Wire::LoadArray(m_header.Payload(), missed.data(), count);
+    if ((client->capabilities & CAPABILITY_FLOW_CONTROL) != 0) {
+        // Fragments the client already acknowledged may be gone from the
+        // dataset, and those not sent yet are left to the window
+        const uint32_t received_through = client->received_through;
+        const uint32_t next_fragment = client->next_fragment;
+        missed.erase(std::remove_if(missed.begin(), missed.end(), [received_through, next_fragment](const uint16_t& number) {
+            return number <= received_through || number >= next_fragment;
+        }), missed.end());
     }
+    QueueFragments(*client, *dataset, missed.data(), missed.size());
+}
 
+void Server::QueueFragments(const Client& client, const Dataset& dataset, const uint16_t* numbers, const uint32_t& count) {
     ToSend to_send;
     to_send.type = MessageType::RESPONSE;
-    to_send.client_addr = client_addr;
-    to_send.data_size = (m_header->total_packets_missed - 1) * (MAX_PACKET_SIZE - sizeof(ProtocolHeader)) + copy_amount;
-    to_send.data = m_buffer;
-    to_send.delete_data = true;
-    to_send.custom_packet_number = true;
-    to_send.packet_numbers = packet_numbers;
+    to_send.client_addr = client.client_addr;
+    to_send.client_id = client.id;
+    to_send.transfer = client.transfer;
+    if (dataset.parts.empty()) {
+        QueueSubStream(std::move(to_send), dataset, numbers, count);
+        return;
+    }
 
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
-        sending_data_.emplace_back(to_send);
-        cv_send.notify_one();
+    // Batch: split the numbers by sub-stream and renumber them from 1
+    const uint32_t part_packets = dataset.parts[0].Packets();
+    to_send.transfer_packets = dataset.Packets();
+    std::vector<std::vector<uint16_t>> local(dataset.parts.size());
+    for (uint32_t i = 0; i < count; ++i) {
+        if (numbers[i] != 0 && numbers[i] <= to_send.transfer_packets) {
+            local[(numbers[i] - 1) / part_packets].push_back((numbers[i] - 1) % part_packets + 1);
+        }
+    }
+    for (size_t part = 0; part < local.size(); ++part) {
+        if (!local[part].empty()) {
+            to_send.packet_offset = part * part_packets;
+            QueueSubStream(to_send, dataset.parts[part], local[part].data(), local[part].size());
+        }
+    }
+}
+
+void Server::QueueSubStream(ToSend to_send, const Dataset& dataset, const uint16_t* numbers, const uint32_t& count) {
+    uint32_t packet_data_size = dataset.packet_data_size;
+    const uint32_t value_size = FragmentCodec::ValueSize(dataset.precision);
+    uint32_t packets_total = dataset.Packets();
+    to_send.compressed = dataset.compressed;
+    to_send.precision = dataset.precision;
+    to_send.checksums = dataset.checksums;
+    to_send.digest_ready = dataset.digest_ready;
+    to_send.digest = dataset.digest;
+    to_send.packet_data_size = packet_data_size;
+    to_send.packet_numbers.reserve(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        if (numbers[i] != 0 && numbers[i] <= packets_total) {
+            to_send.packet_numbers.push_back(numbers[i]);
+        }
+    }
+    if (to_send.packet_numbers.empty()) {
+        return;
+    }
+
+    if (!dataset.data.Empty()) {
+        // Only fragment numbers are queued; the sender slices the payload
+        // straight out of the shared dataset buffer
+        to_send.data = dataset.data;
+        QueueReply(std::move(to_send));
+        return;
+    }
+    if (!dataset.chunks.empty()) {
+        // Each chunk goes out like a sub-stream of its own, renumbered from 1
+        std::vector<std::vector<uint16_t>> local(dataset.chunks.size());
+        for (const uint16_t& packet_number : to_send.packet_numbers) {
+            local[(packet_number - 1) / WINDOW_CHUNK_PACKETS].push_back((packet_number - 1) % WINDOW_CHUNK_PACKETS + 1);
+        }
+        const uint32_t packet_offset = to_send.packet_offset;
+        if (to_send.transfer_packets == 0) {
+            to_send.transfer_packets = packets_total;
+        }
+        for (size_t chunk = 0; chunk < local.size(); ++chunk) {
+            // Acknowledged chunks are never asked for again
+            if (!local[chunk].empty() && !dataset.chunks[chunk].Empty()) {
+                ToSend part = to_send;
+                part.data = dataset.chunks[chunk];
+                part.packet_numbers = std::move(local[chunk]);
+                part.packet_offset = packet_offset + chunk * WINDOW_CHUNK_PACKETS;
+                QueueReply(std::move(part));
+            }
+        }
+        return;
+    }
+
+    // Stateless dataset: rebuild just the requested fragments. Sorted order
+    // keeps the short last fragment at the end of the packed buffer
+    std::sort(to_send.packet_numbers.begin(), to_send.packet_numbers.end());
+    to_send.packet_numbers.erase(std::unique(to_send.packet_numbers.begin(), to_send.packet_numbers.end()),
+                                 to_send.packet_numbers.end());
+    // Each fragment is built in place at its packed offset, with room for
+    // its values as doubles before they are narrowed
+    const uint32_t values_per_packet = packet_data_size / value_size;
+    std::vector<double> values(to_send.packet_numbers.size() * values_per_packet);
+    size_t bytes = 0;
+    for (const uint16_t& packet_number : to_send.packet_numbers) {
+        uint32_t first = (packet_number - 1) * values_per_packet;
+        uint32_t size = std::min(values_per_packet, dataset.count - first);
+        bytes += Precision::Regenerate(dataset.precision, dataset.descending, reinterpret_cast<char*>(values.data()) + bytes,
+                                       first, size, dataset.count, dataset.min, dataset.max, dataset.seed);
     }
+    to_send.data = Buffer::Adopt(std::move(values)).Slice(0, bytes);
+    to_send.packets_total = packets_total;
+    QueueReply(std::move(to_send));
+}
+
+void Server::QueueChunk(const StreamJob& job, Buffer chunk, const uint32_t& first_packet, const uint32_t& packets, const bool& last) {
+    uint32_t packet_data_size = job.packet_data_size;
+    ToSend to_send;
+    to_send.type = MessageType::RESPONSE;
+    to_send.client_addr = job.client_addr;
+    // Only the final chunk counts as the response being sent; probing any
+    // earlier would race the chunks that are still being generated
+    to_send.client_id = last ? job.client_id : INVALID_CLIENT_ID;
+    to_send.transfer = job.transfer;
+    to_send.data = std::move(chunk);
+    to_send.compressed = job.compressed;
+    to_send.precision = job.precision;
+    to_send.checksums = job.checksums;
+    to_send.packet_data_size = packet_data_size;
+    if (last && job.checksums) {
+        // Resends of the final fragment need the digest too
+        to_send.digest_ready = true;
+        to_send.digest = job.digest;
+        const uint32_t client_id = job.client_id;
+        const struct sockaddr_in client_addr = job.client_addr;
+        const uint64_t seed = job.seed;
+        const uint32_t digest = job.digest;
+        PostTask([this, client_id, client_addr, seed, digest]() {
+            EpochGuard guard(client_handler_.GetEpoch());
+            Client* client = client_handler_.GetClient(client_id, client_addr);
+            Dataset* dataset = client != nullptr ? client->dataset.load(std::memory_order_acquire) : nullptr;
+            if (dataset != nullptr && dataset->seed == seed) {
+                dataset->digest = digest;
+                dataset->digest_ready = true;
+            }
+        });
+    }
+    to_send.packets_total = (static_cast<uint64_t>(job.count) * FragmentCodec::ValueSize(job.precision) + packet_data_size - 1)
+                          / packet_data_size;
+    to_send.packet_numbers.resize(packets);
+    for (uint32_t i = 0; i < packets; ++i) {
+        to_send.packet_numbers[i] = first_packet + i;
+    }
+    QueueMessage(std::move(to_send));
+}
+
+void Server::QueueMessage(ToSend to_send) {
+    std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
+    sending_data_.emplace_back(std::move(to_send));
+    cv_send.notify_one();
+}
+
+// Moves the whole batch to the sender under one lock
+void Server::QueueMessages(std::vector<ToSend>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
+    std::move(batch.begin(), batch.end(), std::back_inserter(sending_data_));
+    batch.clear();
+    cv_send.notify_one();
+}
+
+// Replies from the processing thread, which alone queues through here; held
+// back while a BUNDLE is processed
+void Server::QueueReply(ToSend to_send) {
+    if (holding_replies_) {
+        held_replies_.emplace_back(std::move(to_send));
+        return;
+    }
+    QueueMessage(std::move(to_send));
+}
+
+void Server::PostTask(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mx_deque_packets_);
+    tasks_.emplace_back(std::move(task));
+    cv_recv.notify_one();
+}
+
+void Server::OnResponseSent(const uint32_t& client_id, const struct sockaddr_in& client_addr, const uint32_t& transfer) {
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(client_id, client_addr);
+    // Completions of an earlier response may arrive after the next one started
+    if (client == nullptr || client->transfer != transfer || client->dataset.load(std::memory_order_acquire) == nullptr) {
+        return;
+    }
+
+    client->response_sent_at = TimerWheel::Clock::now();
+    ArmRetransmit(*client);
+}
+
+void Server::ArmRetransmit(Client& client) {
+    // First wait is a tail-loss probe (2 * SRTT), later ones back off the RTO
+    RttEstimator::Duration timeout = client.probes_sent == 0 ? rtt_.ProbeTimeout() : rtt_.Backoff(client.probes_sent - 1);
+    timers_.Cancel(client.retransmit_timer);
+    client.retransmit_timer = timers_.Schedule(std::chrono::duration_cast<std::chrono::milliseconds>(timeout + std::chrono::microseconds(999)),
+                                               static_cast<uint8_t>(TimerKind::RETRANSMIT), client.id);
+}
+
+void Server::SendTailProbe(Client& client) {
+    Dataset* dataset = client.dataset.load(std::memory_order_acquire);
+    if (dataset == nullptr) {
+        return;
+    }
+    // Flow controlled transfers probe with the last fragments the window let
+    // out, short of those the client acknowledged
+    const bool windowed = (client.capabilities & CAPABILITY_FLOW_CONTROL) != 0;
+    uint32_t packets_total = windowed ? client.next_fragment - 1 : dataset->Packets();
+    uint32_t count = std::min(packets_total - (windowed ? client.received_through : 0), TAIL_PROBE_PACKETS);
+    if (count == 0) {
+        return;
+    }
+    if (client.probes_sent >= MAX_RETRANSMIT_PROBES) {
+        logger_.Log("Giving up retransmissions for session " + std::to_string(client.id));
+        return;
+    }
+    ++client.probes_sent;
+    client.retransmitted = true;
+
+    // Resending the last fragments lets the client see the end of the
+    // response and report what it is missing without waiting for its timeout
+    std::vector<uint16_t> tail(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        tail[i] = packets_total - count + 1 + i;
+    }
+    QueueFragments(client, *dataset, tail.data(), count);
 }
 
 void Server::ProcessConnect(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
     logger_.Log(__func__);
-    ProtocolHeader* p_header = reinterpret_cast<ProtocolHeader*>(buffer);
-    ConnectHeader* c_header = reinterpret_cast<ConnectHeader*>(buffer + sizeof(ProtocolHeader));
-    if (!CheckVersion(c_header->version_major, c_header->version_minor)) {
+    constexpr size_t VERSION_SIZE = WireCodec<ConnectHeader>::OFFSET<2>;
+    if (buffer_size < PROTOCOL_HEADER_SIZE + VERSION_SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    // Clients before 2.2 send the version only
+    const uint32_t connect_size = buffer_size - PROTOCOL_HEADER_SIZE;
+    const ConnectHeader c_header = WireCodec<ConnectHeader>::DecodePrefix(buffer + PROTOCOL_HEADER_SIZE, connect_size);
+    if (!CheckVersion(c_header.version_major)) {
         SendError(client_addr, ErrorCode::INVALID_VERSION);
         return;
     }
 
+    // Both sides get the fastest path they share: every common capability
+    // and the largest packet size both can handle
+    const bool negotiates = connect_size >= WireCodec<ConnectHeader>::OFFSET<4>;
+    ConnectHeader session;
+    session.version_major = PROTOCOL_VERSION_MAJOR;
+    session.version_minor = PROTOCOL_VERSION_MINOR;
+    session.capabilities = Capabilities() & (negotiates ? c_header.capabilities : LEGACY_CAPABILITIES);
+    uint32_t packet_size = negotiates ? std::min<uint32_t>(c_header.max_packet_size, server_conf_.max_packet_size)
+                                      : DEFAULT_PACKET_SIZE;
+    packet_size = std::min(std::max(packet_size, MIN_PACKET_SIZE), MAX_NEGOTIATED_PACKET_SIZE);
+    const uint32_t packet_data_size = (packet_size - PROTOCOL_HEADER_SIZE) / sizeof(double) * sizeof(double);
+    session.max_packet_size = PROTOCOL_HEADER_SIZE + packet_data_size;
+    // Clients before 2.5 send no window and get no flow control
+    session.receive_window = (session.capabilities & CAPABILITY_FLOW_CONTROL) != 0 ? c_header.receive_window : 0;
+    if (session.receive_window == 0) {
+        session.capabilities &= ~CAPABILITY_FLOW_CONTROL;
+    }
+
     uint32_t client_id = client_handler_.AddClient(client_addr);
-    SendAcknowledge(client_addr, client_id, p_header->packet_number);
+    if (client_id == INVALID_CLIENT_ID) {
+        logger_.Log("No free sessions left");
+        SendError(client_addr, ErrorCode::SERVER_BUSY);
+        return;
+    }
+    {
+        EpochGuard guard(client_handler_.GetEpoch());
+        Client* client = client_handler_.GetClient(client_id);
+        client->capabilities = session.capabilities;
+        client->packet_data_size = packet_data_size;
+        client->receive_window = session.receive_window;
+        client->idle_timer = timers_.Schedule(std::chrono::milliseconds(server_conf_.session_idle_timeout_ms),
+                                              static_cast<uint8_t>(TimerKind::SESSION_IDLE), client_id);
+    }
+    SendAcknowledge(client_addr, client_id, WireView<ProtocolHeader>(buffer).Get<&ProtocolHeader::packet_number>(), session);
+}
+
+uint32_t Server::Capabilities() {
+    uint32_t capabilities = 0;
+    if (server_conf_.compressed_responses) {
+        capabilities |= CAPABILITY_COMPRESSED;
+    }
+    if (server_conf_.reduced_precision) {
+        capabilities |= CAPABILITY_REDUCED_PRECISION;
+    }
+    if (server_conf_.response_checksums) {
+        capabilities |= CAPABILITY_CHECKSUMS;
+    }
+    if (server_conf_.seed_responses) {
+        capabilities |= CAPABILITY_SEED_RESPONSES;
+    }
+    if (server_conf_.bundled_messages) {
+        capabilities |= CAPABILITY_BUNDLES;
+    }
+    if (server_conf_.batch_requests) {
+        capabilities |= CAPABILITY_BATCH_REQUESTS;
+    }
+    if (server_conf_.flow_control) {
+        capabilities |= CAPABILITY_FLOW_CONTROL;
+    }
+    if (server_conf_.best_effort_transfers) {
+        capabilities |= CAPABILITY_BEST_EFFORT;
+    }
+    if (server_conf_.subscriptions) {
+        capabilities |= CAPABILITY_SUBSCRIPTIONS;
+    }
+    return capabilities;
 }
 
-void Server::SendAcknowledge(const struct sockaddr_in& client_addr, const uint32_t& client_id, const uint32_t& packet_number) {
+uint32_t Server::BundleSize(const Client& client) {
+    return (client.capabilities & CAPABILITY_BUNDLES) != 0 ? PROTOCOL_HEADER_SIZE + client.packet_data_size : 0;
+}
+
+void Server::SendAcknowledge(const struct sockaddr_in& client_addr, const uint32_t& client_id, const uint32_t& packet_number,
+                             const ConnectHeader& session) {
     logger_.Log(__func__);
     ToSend ack_to_send;
     AcknowledgeHeader a_header;
     a_header.client_id = client_id;
     a_header.received_packet_number = packet_number;
-    char a_buffer[sizeof(AcknowledgeHeader)];
-    memcpy(a_buffer, &a_header, sizeof(AcknowledgeHeader));
     ack_to_send.type = MessageType::ACKNOWLEDGE;
     ack_to_send.client_addr = client_addr;
-    ack_to_send.data_size = sizeof(AcknowledgeHeader);
-    ack_to_send.data = a_buffer;
-    ack_to_send.delete_data = false;
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
-        sending_data_.push_back(ack_to_send);
-        cv_send.notify_one();
-    }
+    char a_data[WireCodec<AcknowledgeHeader>::SIZE + WireCodec<ConnectHeader>::SIZE];
+    WireCodec<AcknowledgeHeader>::Encode(a_header, a_data);
+    WireCodec<ConnectHeader>::Encode(session, a_data + WireCodec<AcknowledgeHeader>::SIZE);
+    ack_to_send.data = Buffer::Copy(a_data, sizeof(a_data));
+    ack_to_send.bundle_size = (session.capabilities & CAPABILITY_BUNDLES) != 0 ? session.max_packet_size : 0;
+    QueueReply(std::move(ack_to_send));
 }
 
 void Server::ProcessAcknowledge(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
     logger_.Log(__func__);
-    AcknowledgeHeader* header = reinterpret_cast<AcknowledgeHeader*>(buffer + sizeof(ProtocolHeader));
-    logger_.Log("Remove client: " + header->client_id);
-    client_handler_.RemoveClient(header->client_id);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<AcknowledgeHeader>::SIZE) {
+        logger_.Log("Short acknowledge");
+        return;
+    }
+    const AcknowledgeHeader header = WireCodec<AcknowledgeHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    logger_.Log("Remove client: " + std::to_string(header.client_id));
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(header.client_id, client_addr);
+    if (client == nullptr) {
+        logger_.Log("Acknowledge for unknown session");
+        return;
+    }
+    if (!client->retransmitted && client->response_sent_at != TimerWheel::Clock::time_point()) {
+        // Karn's rule: only transfers without retransmissions give RTT samples
+        rtt_.AddSample(std::chrono::duration_cast<RttEstimator::Duration>(TimerWheel::Clock::now() - client->response_sent_at));
+    }
+    CloseSession(*client);
+}
+
+void Server::TouchClient(Client& client) {
+    client.last_activity = TimerWheel::Clock::now();
+}
+
+void Server::CloseSession(Client& client) {
+    timers_.Cancel(client.idle_timer);
+    timers_.Cancel(client.retention_timer);
+    timers_.Cancel(client.retransmit_timer);
+    EndSubscription(client);
+    const struct sockaddr_in client_addr = client.client_addr;
+    client_handler_.RemoveClient(client.id, client_addr);
+}
+
+void Server::OnTimer(const TimerKind& kind, const uint64_t& context) {
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(static_cast<uint32_t>(context));
+    if (client == nullptr) {
+        return;
+    }
+
+    switch (kind) {
+        case TimerKind::SESSION_IDLE: {
+            // Activity only stamps last_activity; the timer re-arms itself for
+            // the remaining time instead of being rescheduled on every packet
+            client->idle_timer = INVALID_TIMER_ID;
+            auto timeout = std::chrono::milliseconds(server_conf_.session_idle_timeout_ms);
+            auto idle = TimerWheel::Clock::now() - client->last_activity;
+            if (idle < timeout) {
+                client->idle_timer = timers_.Schedule(std::chrono::duration_cast<std::chrono::milliseconds>(timeout - idle),
+                                                      static_cast<uint8_t>(TimerKind::SESSION_IDLE), client->id);
+                break;
+            }
+            logger_.Log("Session expired: " + std::to_string(client->id));
+            CloseSession(*client);
+            break;
+        }
+        case TimerKind::RESPONSE_RETENTION: {
+            client->retention_timer = INVALID_TIMER_ID;
+            logger_.Log("Response retention expired: " + std::to_string(client->id));
+            timers_.Cancel(client->retransmit_timer);
+            client_handler_.SetDataset(*client, nullptr);
+            break;
+        }
+        case TimerKind::RETRANSMIT: {
+            client->retransmit_timer = INVALID_TIMER_ID;
+            SendTailProbe(*client);
+            break;
+        }
+        case TimerKind::STREAM_TICK: {
+            client->stream_timer = INVALID_TIMER_ID;
+            StreamTick(*client);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
 }
 
 bool Server::StartServer() {
@@ -218,7 +670,7 @@ void Server::StartReceiving() {
             std::ostringstream oss;
             oss << "sin_family: " << client_addr.sin_family << " sin_port: " << client_addr.sin_port << " addr: " << client_addr.sin_addr.s_addr;
             logger_.Log("Message from: " + oss.str());
-            if (n < sizeof(ProtocolHeader)) {
+            if (n < static_cast<int>(PROTOCOL_HEADER_SIZE)) {
                 SendError(client_addr, ErrorCode::INVALID_HEADER);
                 logger_.Log("Invalid header received");
                 continue;
@@ -250,17 +702,20 @@ void Server::StartSending() {
                 sending_data_.pop_front();
             }
             
-            uint16_t* packet_numbers;
-            if (to_send.custom_packet_number == true) {
-                packet_numbers = to_send.packet_numbers;
+            if (to_send.type == MessageType::RESPONSE) {
+                SendFragments(to_send);
+            } else if (to_send.type == MessageType::STREAM_DATA) {
+                SendDatagrams(to_send);
+            } else if (to_send.bundle_size > 0) {
+                SendBundled(std::move(to_send));
             } else {
-                packet_numbers = nullptr;
+                SendMessage(to_send);
             }
-
-            SendMessage(to_send.client_addr, to_send.data, to_send.data_size, to_send.type, packet_numbers);
-            if (to_send.delete_data == true) {
-                delete to_send.data;
-                delete[] to_send.packet_numbers;
+            if (to_send.type == MessageType::RESPONSE && to_send.client_id != INVALID_CLIENT_ID) {
+                const uint32_t client_id = to_send.client_id;
+                const struct sockaddr_in client_addr = to_send.client_addr;
+                const uint32_t transfer = to_send.transfer;
+                PostTask([this, client_id, client_addr, transfer]() { OnResponseSent(client_id, client_addr, transfer); });
             }
         }
     });
@@ -272,151 +727,1016 @@ void Server::ReadConfigs() {
     protocol_conf_ = reader_.ReadProtocolConfig();
 }
 
-bool Server::CheckVersion(const uint32_t& version_major, const uint32_t& version_minor) {
+bool Server::CheckVersion(const uint32_t& version_major) {
     logger_.Log(__func__);
-    return ((version_major == PROTOCOL_VERSION_MAJOR) && (version_minor == PROTOCOL_VERSION_MINOR));
+    // Minor versions only add optional features, which sessions negotiate
+    return version_major == PROTOCOL_VERSION_MAJOR;
 }
 
 bool Server::ProcessRequest(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
     logger_.Log(__func__);
-    RequestHeader* header = reinterpret_cast<RequestHeader*>(buffer + sizeof(ProtocolHeader));
-
-    ToSend result = DoBusinessLogic(header->client_id, header->value);
-    if (result.data == nullptr) {
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<RequestHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
         return false;
     }
+    const RequestHeader header = WireCodec<RequestHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
 
-    result.type = MessageType::RESPONSE;
+    ToSend result = DoBusinessLogic(client_addr, header.client_id, header.value, header.flags, header.precision);
+    if (result.type == MessageType::ERROR_CODE) {
+        return false;
+    }
 
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
-        sending_data_.push_back(result);
-        cv_send.notify_one();
+    // Streamed responses are queued chunk by chunk by the streamer, flow
+    // controlled ones window by window
+    if (result.type != MessageType::RESPONSE) {
+        QueueReply(std::move(result));
+    } else if (!result.data.Empty()) {
+        QueueReply(std::move(result));
     }
     return true;
 }
 
-bool Server::SendMessage(const struct sockaddr_in& addr, char* buffer, const uint32_t& buffer_size, const MessageType& type, uint16_t* packet_numbers) {
+bool Server::SendMessage(const ToSend& to_send) {
     logger_.Log(__func__);
-    struct sockaddr_in client_addr = addr;
-    #ifdef _WIN32
-    signed int len = sizeof(client_addr);
-    #else
-    socklen_t len = sizeof(client_addr);
-    #endif
+    struct sockaddr_in client_addr = to_send.client_addr;
+    const Buffer& data = to_send.data;
 
     uint32_t sent_bytes = 0;
-    uint32_t remaining_bytes = buffer_size;
-    
-    uint32_t counter = 0;
-    uint32_t data_size = MAX_PACKET_SIZE - sizeof(ProtocolHeader);
-    signed char mbuffer[MAX_PACKET_SIZE];
+    uint32_t remaining_bytes = data.Size();
+    uint32_t data_size = to_send.packet_data_size;
+    char mbuffer[MAX_NEGOTIATED_PACKET_SIZE];
 
     ProtocolHeader header;
-    ProtocolHeader* test;
-    header.packets_total = buffer_size / data_size;
-    if (buffer_size % MAX_PACKET_SIZE > 0) {
+    header.packets_total = data.Size() / data_size;
+    if (data.Size() % data_size > 0) {
         ++header.packets_total;
     }
     std::ostringstream oss;
     oss << __func__ << ": server packets total: " << header.packets_total;
-            
+
     logger_.Log(oss.str());
     header.packet_number = 0;
     header.data_size = data_size;
-    header.type = type;
+    header.type = to_send.type;
+    header.encoding = FragmentEncoding::RAW;
 
-    uint32_t offset = 0;
     while (remaining_bytes > 0) {
-        if (packet_numbers == nullptr) {
-            ++header.packet_number;            
-        } else {
-            header.packet_number = packet_numbers[counter];
-            //std::cout << "sending packet: " << header.packet_number << "\n";
-        }
-        ++counter;
-        memcpy(mbuffer, &header, sizeof(ProtocolHeader));
-        memcpy(mbuffer + sizeof(ProtocolHeader), buffer + sent_bytes, data_size);
-        test = reinterpret_cast<ProtocolHeader*>(mbuffer);
+        ++header.packet_number;
+        uint32_t chunk = std::min(remaining_bytes, data_size);
+        WireCodec<ProtocolHeader>::Encode(header, mbuffer);
+        memcpy(mbuffer + PROTOCOL_HEADER_SIZE, data.Data() + sent_bytes, chunk);
 
-        int bytes_to_send = std::min(static_cast<uint32_t>(remaining_bytes + sizeof(ProtocolHeader)), MAX_PACKET_SIZE);
-        int bytes_sent = sendto(sockfd, mbuffer, bytes_to_send, 0, 
+        int bytes_sent = sendto(sockfd, mbuffer, chunk + PROTOCOL_HEADER_SIZE, 0,
                                 (struct sockaddr *)&client_addr, sizeof(client_addr));
         if (bytes_sent < 0) {
             logger_.Log("Error sending data");
             break;
         }
-        sent_bytes += bytes_sent - sizeof(ProtocolHeader);
-        remaining_bytes -= bytes_sent - sizeof(ProtocolHeader);
-        sleep(0.01);
+        sent_bytes += chunk;
+        remaining_bytes -= chunk;
+    }
+
+    return true;
+}
+
+void Server::SendBundled(ToSend to_send) {
+    logger_.Log(__func__);
+    const struct sockaddr_in peer = to_send.client_addr;
+    uint32_t capacity = to_send.bundle_size;
+    size_t size = 2 * PROTOCOL_HEADER_SIZE + to_send.data.Size();
+    if (size > capacity) {
+        SendMessage(to_send);
+        return;
+    }
+    // Picks up further control messages for the peer, waiting up to
+    // bundle_delay_us for them as long as nothing else is queued
+    std::vector<ToSend> bundle;
+    bundle.emplace_back(std::move(to_send));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(server_conf_.bundle_delay_us);
+    {
+        std::unique_lock<std::mutex> lock(mx_deque_sending_data_);
+        bool full = false;
+        while (true) {
+            for (auto it = sending_data_.begin(); it != sending_data_.end();) {
+                if (it->client_addr.sin_addr.s_addr != peer.sin_addr.s_addr || it->client_addr.sin_port != peer.sin_port) {
+                    ++it;
+                    continue;
+                }
+                const size_t next = size + PROTOCOL_HEADER_SIZE + it->data.Size();
+                if (it->type == MessageType::RESPONSE || next > std::min(capacity, it->bundle_size)) {
+                    // Later messages for the peer keep their place behind it
+                    full = true;
+                    break;
+                }
+                size = next;
+                bundle.emplace_back(std::move(*it));
+                it = sending_data_.erase(it);
+            }
+            if (full || !sending_data_.empty()
+                || !cv_send.wait_until(lock, deadline, [this](){ return !sending_data_.empty(); })) {
+                break;
+            }
+        }
+    }
+
+    if (bundle.size() == 1) {
+        SendMessage(bundle[0]);
+        return;
+    }
+    char datagram[MAX_NEGOTIATED_PACKET_SIZE];
+    BundleWriter writer(datagram, capacity);
+    for (const ToSend& message : bundle) {
+        writer.Append(message.type, message.data.Data(), message.data.Size());
+    }
+    const size_t datagram_size = writer.Finish();
+    logger_.Log("Bundled " + std::to_string(writer.Count()) + " messages");
+    if (sendto(sockfd, datagram, datagram_size, 0, (const struct sockaddr *)&peer, sizeof(peer)) < 0) {
+        logger_.Log("Error sending data");
+    }
+}
+
+bool Server::SendFragments(const ToSend& to_send) {
+    logger_.Log(__func__);
+    struct sockaddr_in client_addr = to_send.client_addr;
+    const Buffer& data = to_send.data;
+    const std::vector<uint16_t>& packet_numbers = to_send.packet_numbers;
+    const uint32_t& total = to_send.packets_total;
+    const bool& compressed = to_send.compressed;
+    const ValuePrecision& precision = to_send.precision;
+    const uint32_t packet_data_size = to_send.packet_data_size;
+    // A packed buffer carries only the listed fragments, in list order
+    const bool packed = total != 0;
+    const uint32_t packets_total = packed ? total : (data.Size() + packet_data_size - 1) / packet_data_size;
+    const uint32_t packets = packet_numbers.empty() ? packets_total : packet_numbers.size();
+    const uint32_t wire_packets_total = to_send.transfer_packets != 0 ? to_send.transfer_packets : packets_total;
+
+    std::ostringstream oss;
+    oss << __func__ << ": sending " << packets << " of " << packets_total << " packets";
+    logger_.Log(oss.str());
+
+    // Each datagram is gathered from a header and a slice of the dataset, so
+    // the payload is never copied in user space. Compressed fragments are
+    // encoded into a per-batch scratch area instead. Dataset buffers are
+    // sent as they are, which is the little-endian wire format
+    char headers[SEND_BATCH_SIZE][PROTOCOL_HEADER_SIZE];
+    char trailers[SEND_BATCH_SIZE][MAX_TRAILER_SIZE];
+    std::unique_ptr<char[]> encoded(compressed ? new char[SEND_BATCH_SIZE * packet_data_size] : nullptr);
+    // Narrowed payloads are already in their wire format
+    const FragmentEncoding encoding = precision == ValuePrecision::FLOAT32 ? FragmentEncoding::FLOAT32
+                                    : precision == ValuePrecision::FIXED32 ? FragmentEncoding::FIXED32
+                                    : FragmentEncoding::RAW;
+    const uint32_t parts = to_send.checksums ? 3 : 2;
+    #ifdef _WIN32
+    WSABUF buffers[3];
+    #else
+    struct iovec iovecs[SEND_BATCH_SIZE][3];
+    #ifdef __linux__
+    struct mmsghdr messages[SEND_BATCH_SIZE];
+    #endif
+    #endif
+
+    uint32_t sent = 0;
+    while (sent < packets) {
+        uint32_t batch = std::min(packets - sent, SEND_BATCH_SIZE);
+        for (uint32_t i = 0; i < batch; ++i) {
+            uint16_t packet_number = packet_numbers.empty() ? sent + i + 1 : packet_numbers[sent + i];
+            uint32_t fragment_index = packed ? sent + i : packet_number - 1;
+            Buffer fragment = data.Slice(fragment_index * packet_data_size, packet_data_size);
+            const char* payload = fragment.Data();
+            uint32_t payload_size = fragment.Size();
+            ProtocolHeader header;
+            header.encoding = encoding;
+            if (compressed && encoding == FragmentEncoding::RAW) {
+                char* out = encoded.get() + i * packet_data_size;
+                payload_size = FragmentCodec::Encode(fragment.As<double>(), fragment.Size() / sizeof(double), out,
+                                                     header.encoding);
+                payload = out;
+            }
+            header.packet_number = to_send.packet_offset + packet_number;
+            header.packets_total = wire_packets_total;
+            header.data_size = payload_size;
+            header.type = MessageType::RESPONSE;
+            WireCodec<ProtocolHeader>::Encode(header, headers[i]);
+            uint32_t trailer_size = 0;
+            if (to_send.checksums) {
+                uint32_t crc = Crc32c::Extend(Crc32c::Compute(headers[i], PROTOCOL_HEADER_SIZE), payload, payload_size);
+                if (header.packet_number == header.packets_total && to_send.digest_ready) {
+                    WireCodec<DatasetDigest>::Encode(DatasetDigest{to_send.digest}, trailers[i]);
+                    crc = Crc32c::Extend(crc, trailers[i], WireCodec<DatasetDigest>::SIZE);
+                    trailer_size = WireCodec<DatasetDigest>::SIZE;
+                }
+                WireCodec<FragmentChecksum>::Encode(FragmentChecksum{crc}, trailers[i] + trailer_size);
+                trailer_size += WireCodec<FragmentChecksum>::SIZE;
+            }
+
+            #ifdef _WIN32
+            buffers[0].buf = headers[i];
+            buffers[0].len = PROTOCOL_HEADER_SIZE;
+            buffers[1].buf = const_cast<char*>(payload);
+            buffers[1].len = payload_size;
+            buffers[2].buf = trailers[i];
+            buffers[2].len = trailer_size;
+            DWORD bytes_sent = 0;
+            if (WSASendTo(sockfd, buffers, parts, &bytes_sent, 0, (struct sockaddr *)&client_addr, sizeof(client_addr), nullptr, nullptr) == SOCKET_ERROR) {
+                logger_.Log("Error sending data");
+                return false;
+            }
+            #else
+            iovecs[i][0].iov_base = headers[i];
+            iovecs[i][0].iov_len = PROTOCOL_HEADER_SIZE;
+            iovecs[i][1].iov_base = const_cast<char*>(payload);
+            iovecs[i][1].iov_len = payload_size;
+            iovecs[i][2].iov_base = trailers[i];
+            iovecs[i][2].iov_len = trailer_size;
+            #ifdef __linux__
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = &client_addr;
+            messages[i].msg_hdr.msg_namelen = sizeof(client_addr);
+            messages[i].msg_hdr.msg_iov = iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = parts;
+            #else
+            struct msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_name = &client_addr;
+            message.msg_namelen = sizeof(client_addr);
+            message.msg_iov = iovecs[i];
+            message.msg_iovlen = parts;
+            if (sendmsg(sockfd, &message, 0) < 0) {
+                logger_.Log("Error sending data");
+                return false;
+            }
+            #endif
+            #endif
+        }
+
+        #ifdef __linux__
+        uint32_t batch_sent = 0;
+        while (batch_sent < batch) {
+            int n = sendmmsg(sockfd, messages + batch_sent, batch - batch_sent, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logger_.Log("Error sending data");
+                return false;
+            }
+            batch_sent += n;
+        }
+        #endif
+        sent += batch;
+    }
+
+    return true;
+}
+
+// Datagrams StreamTick built whole; they go out as they are
+bool Server::SendDatagrams(const ToSend& to_send) {
+    struct sockaddr_in client_addr = to_send.client_addr;
+    const char* data = to_send.data.Data();
+    const uint32_t size = to_send.data.Size();
+    const uint32_t datagrams = (size + to_send.datagram_size - 1) / to_send.datagram_size;
+    #ifdef __linux__
+    struct iovec iovecs[SEND_BATCH_SIZE];
+    struct mmsghdr messages[SEND_BATCH_SIZE];
+    #endif
+
+    uint32_t sent = 0;
+    while (sent < datagrams) {
+        uint32_t batch = std::min(datagrams - sent, SEND_BATCH_SIZE);
+        for (uint32_t i = 0; i < batch; ++i) {
+            const uint32_t offset = (sent + i) * to_send.datagram_size;
+            const uint32_t datagram_size = std::min(to_send.datagram_size, size - offset);
+            #ifdef __linux__
+            iovecs[i].iov_base = const_cast<char*>(data + offset);
+            iovecs[i].iov_len = datagram_size;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = &client_addr;
+            messages[i].msg_hdr.msg_namelen = sizeof(client_addr);
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            #else
+            if (sendto(sockfd, data + offset, datagram_size, 0, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+                logger_.Log("Error sending data");
+                return false;
+            }
+            #endif
+        }
+
+        #ifdef __linux__
+        uint32_t batch_sent = 0;
+        while (batch_sent < batch) {
+            int n = sendmmsg(sockfd, messages + batch_sent, batch - batch_sent, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logger_.Log("Error sending data");
+                return false;
+            }
+            batch_sent += n;
+        }
+        #endif
+        sent += batch;
     }
 
     return true;
 }
 
-void Server::SendError(const struct sockaddr_in& client_addr, const ErrorCode& code) {
+void Server::SendError(const struct sockaddr_in& client_addr, const ErrorCode& code, const uint32_t& bundle_size) {
     logger_.Log(__func__);
     ToSend error_to_send;
     ErrorHeader e_header;
     e_header.error = code;
     e_header.version_major = PROTOCOL_VERSION_MAJOR;
     e_header.version_minor = PROTOCOL_VERSION_MINOR;
-    char e_buffer[sizeof(ErrorHeader)];
-    memcpy(e_buffer, &e_header, sizeof(ErrorHeader));
     error_to_send.type = MessageType::ERROR_CODE;
     error_to_send.client_addr = client_addr;
-    error_to_send.data_size = sizeof(ErrorHeader);
-    error_to_send.data = e_buffer;
-    error_to_send.delete_data = false;
-    {
-        std::lock_guard<std::mutex> lock(mx_deque_sending_data_);
-        sending_data_.push_back(error_to_send);
-        cv_send.notify_one();
-    }
+    char e_data[WireCodec<ErrorHeader>::SIZE];
+    WireCodec<ErrorHeader>::Encode(e_header, e_data);
+    error_to_send.data = Buffer::Copy(e_data, sizeof(e_data));
+    error_to_send.bundle_size = bundle_size;
+    QueueReply(std::move(error_to_send));
 }
 
-ToSend Server::DoBusinessLogic(const uint32_t& client_id, const double& value) {
+ToSend Server::DoBusinessLogic(const struct sockaddr_in& client_addr, const uint32_t& client_id, const double& value,
+                               const uint8_t& flags, const ValuePrecision& requested_precision) {
     logger_.Log(__func__);
     ToSend to_send;
+    // Stays ERROR_CODE unless a response was produced
+    to_send.type = MessageType::ERROR_CODE;
 
-    Client& client = client_handler_.GetClient(client_id);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client_ptr = client_handler_.GetClient(client_id, client_addr);
+    if (client_ptr == nullptr) {
+        SendError(client_addr, ErrorCode::INVALID_SESSION);
+        return to_send;
+    }
+    Client& client = *client_ptr;
+    TouchClient(client);
     uint32_t count = protocol_conf_.values_amount;
     double min = 0;
     double max = 0;
-    if (value > 0) {
-        min -= value;
-        max = value;
+    // Servers that do not narrow answer in full precision, which clients
+    // can tell from the fragment encoding
+    const ValuePrecision precision = (client.capabilities & CAPABILITY_REDUCED_PRECISION) != 0 ? requested_precision
+                                                                                               : ValuePrecision::FLOAT64;
+    if (!ValueRange(value, min, max) || !Precision::Representable(precision, count, min, max)) {
+        SendError(client.client_addr, ErrorCode::INVALID_VALUE, BundleSize(client));
+        return to_send;
+    }
+    // Values come out distinct and in ascending order. Stateless datasets are
+    // only kept as (seed, count, range); ranges too narrow for the
+    // counter-based layout fall back to a stored copy
+    Dataset* dataset = new Dataset;
+    dataset->seed = generator_.NextSeed();
+    dataset->count = count;
+    dataset->min = min;
+    dataset->max = max;
+    // Generated values are ascending, so delivering them sorted descending
+    // only takes a reversal; no sort is needed on either side
+    dataset->descending = (flags & REQUEST_FLAG_SORT_DESCENDING) != 0;
+    dataset->precision = precision;
+    // The codec works on doubles; narrowed items go out as they are
+    dataset->compressed = (flags & REQUEST_FLAG_COMPRESSED) != 0 && (client.capabilities & CAPABILITY_COMPRESSED) != 0
+                       && precision == ValuePrecision::FLOAT64;
+    dataset->checksums = (flags & REQUEST_FLAG_CHECKSUMS) != 0 && (client.capabilities & CAPABILITY_CHECKSUMS) != 0;
+    dataset->packet_data_size = client.packet_data_size;
+    const bool best_effort = (flags & REQUEST_FLAG_BEST_EFFORT) != 0 && (client.capabilities & CAPABILITY_BEST_EFFORT) != 0;
+    const bool flow_control = (client.capabilities & CAPABILITY_FLOW_CONTROL) != 0 && !best_effort;
+    // Fragment numbers are 16 bits on the wire, which bounds a response at
+    // UINT16_MAX fragments of the session's packet size and precision
+    if (dataset->Packets() > UINT16_MAX) {
+        delete dataset;
+        SendError(client.client_addr, ErrorCode::INVALID_VALUE, BundleSize(client));
+        return to_send;
+    }
+    std::vector<double> values;
+    DatasetPool::Entry pooled;
+    bool streamed = false;
+    if ((flags & REQUEST_FLAG_SEED_ONLY) != 0 && (client.capabilities & CAPABILITY_SEED_RESPONSES) != 0) {
+        // Nothing is generated here: the client rebuilds the stateless values
+        // itself and asks again without the flag if it cannot
+        SeedResponseHeader s_header;
+        s_header.generator_version = GENERATOR_VERSION;
+        s_header.count = count;
+        s_header.seed = dataset->seed;
+        s_header.min = min;
+        s_header.max = max;
+        to_send.type = MessageType::SEED_RESPONSE;
+        char s_data[WireCodec<SeedResponseHeader>::SIZE];
+        WireCodec<SeedResponseHeader>::Encode(s_header, s_data);
+        to_send.data = Buffer::Copy(s_data, sizeof(s_data));
+        to_send.bundle_size = BundleSize(client);
+    } else if (pool_.Take(max, pooled)) {
+        to_send.type = MessageType::RESPONSE;
+        dataset->seed = pooled.seed;
+        to_send.data = pooled.data;
+        if (precision != ValuePrecision::FLOAT64) {
+            to_send.data = NarrowDataset(*dataset, pooled.data.As<double>());
+        } else if (dataset->descending) {
+            // Pooled buffers are shared and immutable; mirror into a new one
+            const double* begin = pooled.data.As<double>();
+            values.assign(std::reverse_iterator<const double*>(begin + count), std::reverse_iterator<const double*>(begin));
+            to_send.data = Buffer::Adopt(std::move(values));
+        }
+        if (!pooled.stateless) {
+            dataset->data = to_send.data;
+        }
+    } else if (server_conf_.streaming_responses && !flow_control && Generator::Stratifiable(count, min, max)) {
+        // Streamed values come from the counter-based stream, so the session
+        // keeps only the seed, like a stateless dataset
+        to_send.type = MessageType::RESPONSE;
+        streamed = true;
+    } else if (server_conf_.stateless_datasets && generator_.GenerateStateless(values, count, min, max, dataset->seed)) {
+        to_send.type = MessageType::RESPONSE;
+        if (precision != ValuePrecision::FLOAT64) {
+            to_send.data = NarrowDataset(*dataset, values.data());
+        } else {
+            if (dataset->descending) {
+                std::reverse(values.begin(), values.end());
+            }
+            to_send.data = Buffer::Adopt(std::move(values));
+        }
+    } else if (generator_.GenerateUnique(values, count, min, max, dataset->seed)) {
+        to_send.type = MessageType::RESPONSE;
+        if (precision != ValuePrecision::FLOAT64) {
+            dataset->data = NarrowDataset(*dataset, values.data());
+        } else {
+            if (dataset->descending) {
+                std::reverse(values.begin(), values.end());
+            }
+            dataset->data = Buffer::Adopt(std::move(values));
+        }
+        to_send.data = dataset->data;
+    } else {
+        delete dataset;
+        SendError(client.client_addr, ErrorCode::INVALID_VALUE, BundleSize(client));
+        return to_send;
+    }
+    if (to_send.type == MessageType::RESPONSE && dataset->checksums && !streamed) {
+        // data is the whole response in wire format and fragment order
+        dataset->digest = Crc32c::Compute(to_send.data.Data(), to_send.data.Size());
+        dataset->digest_ready = true;
     }
-    if (value < 0) {
-        min = value;
-        max -= value;
+    if (to_send.type == MessageType::RESPONSE) {
+        logger_.Log("Dataset pool hits: " + std::to_string(pool_.Hits()) + " misses: " + std::to_string(pool_.Misses()));
     }
-    if (value == 0) {
-        SendError(client.client_addr, ErrorCode::INVALID_VALUE);
-        to_send.data = nullptr;
+    const bool windowed = to_send.type == MessageType::RESPONSE && flow_control;
+    if (windowed) {
+        // Stateless values are regenerated as the window moves on
+        HoldInChunks(*dataset);
+    }
+    StartTransfer(client, best_effort ? nullptr : dataset);
+    if (windowed) {
+        SendWindow(client);
+        to_send.data = Buffer();
         return to_send;
     }
-    // Seed random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<double> dis(min, max);
 
-    // Use unordered_set to ensure uniqueness
-    std::unordered_set<double> unique_set;
+    // The queued buffer keeps the values alive even if the session is
+    // acknowledged or expires mid-transfer
+    to_send.client_addr = client.client_addr;
+    to_send.client_id = best_effort ? INVALID_CLIENT_ID : client.id;
+    to_send.transfer = client.transfer;
+    to_send.compressed = dataset->compressed;
+    to_send.precision = dataset->precision;
+    to_send.checksums = dataset->checksums;
+    to_send.digest_ready = dataset->digest_ready;
+    to_send.digest = dataset->digest;
+    to_send.packet_data_size = dataset->packet_data_size;
+    if (streamed) {
+        StreamJob job;
+        job.client_addr = client.client_addr;
+        job.client_id = client.id;
+        job.transfer = client.transfer;
+        job.seed = dataset->seed;
+        job.count = count;
+        job.min = min;
+        job.max = max;
+        job.descending = dataset->descending;
+        job.compressed = dataset->compressed;
+        job.precision = dataset->precision;
+        job.checksums = dataset->checksums;
+        job.packet_data_size = dataset->packet_data_size;
+        streamer_.Submit(job);
+    }
+    if (best_effort) {
+        delete dataset;
+    }
+    return to_send;
+}
 
-    while (unique_set.size() < static_cast<size_t>(count)) {
-        unique_set.insert(dis(gen));
+bool Server::ProcessBatchRequest(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    constexpr size_t HEADERS_SIZE = PROTOCOL_HEADER_SIZE + WireCodec<BatchRequestHeader>::SIZE;
+    if (buffer_size < HEADERS_SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return false;
+    }
+    WireView<BatchRequestHeader> view(buffer + PROTOCOL_HEADER_SIZE);
+    const BatchRequestHeader header = view.Decode();
+    if (header.values == 0 || header.values > MAX_BATCH_VALUES
+        || buffer_size < HEADERS_SIZE + static_cast<size_t>(header.values) * sizeof(double)) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return false;
     }
+    std::vector<double> values(header.values);
+    Wire::LoadArray(view.Payload(), values.data(), values.size());
 
-    // Convert unordered_set to vector
-    client.data = std::move(std::vector<double>(unique_set.begin(), unique_set.end()));
-    client.data_size = client.data.size() * sizeof(double);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client_ptr = client_handler_.GetClient(header.client_id, client_addr);
+    if (client_ptr == nullptr) {
+        SendError(client_addr, ErrorCode::INVALID_SESSION);
+        return false;
+    }
+    Client& client = *client_ptr;
+    TouchClient(client);
+    if ((client.capabilities & CAPABILITY_BATCH_REQUESTS) == 0) {
+        SendError(client.client_addr, ErrorCode::INVALID_HEADER, BundleSize(client));
+        return false;
+    }
 
-    to_send.data = reinterpret_cast<char*>(client.data.data());
-    to_send.data_size = client.data_size;
-    to_send.client_addr = client.client_addr;
-    to_send.delete_data = false;
-    return to_send;
+    // Every value gets a dataset of its own, built as for a REQUEST with the
+    // same options; the whole batch has to fit into one transfer
+    const ValuePrecision precision = (client.capabilities & CAPABILITY_REDUCED_PRECISION) != 0 ? header.precision
+                                                                                               : ValuePrecision::FLOAT64;
+    Dataset part_template;
+    part_template.count = protocol_conf_.values_amount;
+    part_template.descending = (header.flags & REQUEST_FLAG_SORT_DESCENDING) != 0;
+    part_template.precision = precision;
+    part_template.compressed = (header.flags & REQUEST_FLAG_COMPRESSED) != 0 && (client.capabilities & CAPABILITY_COMPRESSED) != 0
+                            && precision == ValuePrecision::FLOAT64;
+    part_template.checksums = (header.flags & REQUEST_FLAG_CHECKSUMS) != 0 && (client.capabilities & CAPABILITY_CHECKSUMS) != 0;
+    part_template.packet_data_size = client.packet_data_size;
+    const bool best_effort = (header.flags & REQUEST_FLAG_BEST_EFFORT) != 0 && (client.capabilities & CAPABILITY_BEST_EFFORT) != 0;
+    bool valid = part_template.Packets() * values.size() <= UINT16_MAX;
+    // The batch shares the options of its parts
+    Dataset* batch = new Dataset(part_template);
+    batch->parts.assign(values.size(), part_template);
+    for (size_t i = 0; i < values.size() && valid; ++i) {
+        Dataset& part = batch->parts[i];
+        valid = ValueRange(values[i], part.min, part.max) && Precision::Representable(precision, part.count, part.min, part.max);
+    }
+    // Each dataset is generated on all cores in turn
+    std::vector<Buffer> payloads(values.size());
+    for (size_t i = 0; i < values.size() && valid; ++i) {
+        valid = GenerateBatchPart(batch->parts[i], payloads[i]);
+    }
+    if (!valid) {
+        delete batch;
+        SendError(client.client_addr, ErrorCode::INVALID_VALUE, BundleSize(client));
+        return false;
+    }
+    if (batch->checksums) {
+        // Resends of the final fragment take the digest from the last part
+        for (const Buffer& payload : payloads) {
+            batch->digest = Crc32c::Extend(batch->digest, payload.Data(), payload.Size());
+        }
+        batch->digest_ready = true;
+        batch->parts.back().digest = batch->digest;
+        batch->parts.back().digest_ready = true;
+    }
+    if ((client.capabilities & CAPABILITY_FLOW_CONTROL) != 0 && !best_effort) {
+        for (Dataset& part : batch->parts) {
+            HoldInChunks(part);
+        }
+        StartTransfer(client, batch);
+        SendWindow(client);
+        return true;
+    }
+    StartTransfer(client, best_effort ? nullptr : batch);
+
+    const uint32_t part_packets = batch->parts[0].Packets();
+    for (size_t i = 0; i < values.size(); ++i) {
+        const Dataset& part = batch->parts[i];
+        ToSend to_send;
+        to_send.type = MessageType::RESPONSE;
+        to_send.client_addr = client.client_addr;
+        // Only the final sub-stream counts as the response being sent
+        to_send.client_id = i + 1 == values.size() && !best_effort ? client.id : INVALID_CLIENT_ID;
+        to_send.transfer = client.transfer;
+        to_send.data = payloads[i];
+        to_send.compressed = part.compressed;
+        to_send.precision = part.precision;
+        to_send.checksums = part.checksums;
+        to_send.digest_ready = part.digest_ready;
+        to_send.digest = part.digest;
+        to_send.packet_data_size = part.packet_data_size;
+        to_send.packet_offset = i * part_packets;
+        to_send.transfer_packets = batch->Packets();
+        QueueReply(std::move(to_send));
+    }
+    if (best_effort) {
+        delete batch;
+    }
+    return true;
+}
+
+// Values of one sub-stream of a batch, the same sources as DoBusinessLogic
+// except streaming. `data` gets the payload in wire format
+bool Server::GenerateBatchPart(Dataset& part, Buffer& data) {
+    std::vector<double> values;
+    DatasetPool::Entry pooled;
+    part.seed = generator_.NextSeed();
+    if (pool_.Take(part.max, pooled)) {
+        part.seed = pooled.seed;
+        data = pooled.data;
+        if (part.precision != ValuePrecision::FLOAT64) {
+            data = NarrowDataset(part, pooled.data.As<double>());
+        } else if (part.descending) {
+            const double* begin = pooled.data.As<double>();
+            values.assign(std::reverse_iterator<const double*>(begin + part.count), std::reverse_iterator<const double*>(begin));
+            data = Buffer::Adopt(std::move(values));
+        }
+        if (!pooled.stateless) {
+            part.data = data;
+        }
+        return true;
+    }
+    const bool stateless = server_conf_.stateless_datasets
+                        && generator_.GenerateStateless(values, part.count, part.min, part.max, part.seed);
+    if (!stateless && !generator_.GenerateUnique(values, part.count, part.min, part.max, part.seed)) {
+        return false;
+    }
+    if (part.precision != ValuePrecision::FLOAT64) {
+        data = NarrowDataset(part, values.data());
+    } else {
+        if (part.descending) {
+            std::reverse(values.begin(), values.end());
+        }
+        data = Buffer::Adopt(std::move(values));
+    }
+    if (!stateless) {
+        part.data = data;
+    }
+    return true;
+}
+
+// Makes `dataset` the session's response, replacing any earlier one.
+// Best-effort transfers pass nullptr: nothing is retained or probed
+void Server::StartTransfer(Client& client, Dataset* dataset) {
+    client_handler_.SetDataset(client, dataset);
+    ++client.transfer;
+    timers_.Cancel(client.retransmit_timer);
+    client.probes_sent = 0;
+    client.retransmitted = false;
+    client.response_sent_at = TimerWheel::Clock::time_point();
+    client.received_through = 0;
+    client.next_fragment = 1;
+    timers_.Cancel(client.retention_timer);
+    if (dataset == nullptr) {
+        return;
+    }
+    client.retention_timer = timers_.Schedule(std::chrono::milliseconds(server_conf_.response_retention_ms),
+                                              static_cast<uint8_t>(TimerKind::RESPONSE_RETENTION), client.id);
+}
+
+void Server::ProcessCumulativeAck(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<CumulativeAckHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    const CumulativeAckHeader header = WireCodec<CumulativeAckHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(header.client_id, client_addr);
+    Dataset* dataset = client != nullptr ? client->dataset.load(std::memory_order_acquire) : nullptr;
+    // Late ones may trail the ACKNOWLEDGE that closed the session
+    if (dataset == nullptr || (client->capabilities & CAPABILITY_FLOW_CONTROL) == 0) {
+        logger_.Log("Cumulative acknowledge without a transfer");
+        return;
+    }
+    TouchClient(*client);
+    // Reordered ones are stale; the window is relative to received_through
+    if (header.received_through < client->received_through || header.received_through >= client->next_fragment) {
+        return;
+    }
+    if (header.received_through > client->received_through) {
+        // The client keeps up; probing starts over from here
+        client->received_through = header.received_through;
+        client->probes_sent = 0;
+        if (client->retransmit_timer != INVALID_TIMER_ID) {
+            ArmRetransmit(*client);
+        }
+        ReleaseAcknowledged(*dataset, client->received_through);
+    }
+    client->receive_window = header.window;
+    SendWindow(*client);
+}
+
+// Queues the fragments the receiver window has room for
+void Server::SendWindow(Client& client) {
+    Dataset* dataset = client.dataset.load(std::memory_order_acquire);
+    if (dataset == nullptr) {
+        return;
+    }
+    const uint32_t limit = std::min(dataset->Packets(), client.received_through + client.receive_window);
+    if (client.next_fragment > limit) {
+        return;
+    }
+    std::vector<uint16_t> numbers(limit - client.next_fragment + 1);
+    for (size_t i = 0; i < numbers.size(); ++i) {
+        numbers[i] = client.next_fragment + i;
+    }
+    client.next_fragment = limit + 1;
+    QueueFragments(client, *dataset, numbers.data(), numbers.size());
+}
+
+// Splits the values a windowed transfer holds into chunks that can be
+// released one at a time. Stateless datasets hold nothing to split
+void Server::HoldInChunks(Dataset& dataset) {
+    if (dataset.data.Empty()) {
+        return;
+    }
+    const size_t chunk_size = static_cast<size_t>(WINDOW_CHUNK_PACKETS) * dataset.packet_data_size;
+    dataset.chunks.reserve((dataset.data.Size() + chunk_size - 1) / chunk_size);
+    for (size_t offset = 0; offset < dataset.data.Size(); offset += chunk_size) {
+        Buffer chunk = dataset.data.Slice(offset, chunk_size);
+        dataset.chunks.push_back(Buffer::Copy(chunk.Data(), chunk.Size()));
+    }
+    dataset.data = Buffer();
+}
+
+// Fragments up to received_through are never sent again, so every chunk the
+// client holds in full is dropped; queued sends keep their chunks alive
+void Server::ReleaseAcknowledged(Dataset& dataset, const uint32_t& received_through) {
+    if (dataset.parts.empty()) {
+        const size_t chunks = received_through == dataset.Packets() ? dataset.chunks.size()
+                            : std::min<size_t>(received_through / WINDOW_CHUNK_PACKETS, dataset.chunks.size());
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            dataset.chunks[chunk] = Buffer();
+        }
+        return;
+    }
+    const uint32_t part_packets = dataset.parts[0].Packets();
+    for (uint32_t part = 0; part < dataset.parts.size() && part * part_packets < received_through; ++part) {
+        ReleaseAcknowledged(dataset.parts[part], std::min(received_through - part * part_packets, part_packets));
+    }
+}
+
+void Server::ProcessSubscribe(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<SubscribeHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    const SubscribeHeader header = WireCodec<SubscribeHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(header.client_id, client_addr);
+    if (client == nullptr) {
+        SendError(client_addr, ErrorCode::INVALID_SESSION);
+        return;
+    }
+    TouchClient(*client);
+    if ((client->capabilities & CAPABILITY_SUBSCRIPTIONS) == 0) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER, BundleSize(*client));
+        return;
+    }
+    double min = 0;
+    double max = 0;
+    if (header.rate == 0 || header.rate > server_conf_.max_subscription_rate || !ValueRange(header.value, min, max)) {
+        SendError(client_addr, ErrorCode::INVALID_VALUE, BundleSize(*client));
+        return;
+    }
+
+    EndSubscription(*client);
+    client->subscription_rate = header.rate;
+    client->stream_seed = generator_.NextSeed();
+    client->stream_values = 0;
+    client->stream_sequence = 0;
+    client->stream_min = min;
+    client->stream_max = max;
+    client->stream_started = TimerWheel::Clock::now();
+    client->stream_timer = timers_.Schedule(std::chrono::milliseconds(STREAM_TICK_MS),
+                                            static_cast<uint8_t>(TimerKind::STREAM_TICK), client->id);
+}
+
+void Server::ProcessUnsubscribe(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<UnsubscribeHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    const UnsubscribeHeader header = WireCodec<UnsubscribeHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(header.client_id, client_addr);
+    // Repeated ones may trail the ACKNOWLEDGE that closed the session
+    if (client == nullptr) {
+        logger_.Log("Unsubscribe for unknown session");
+        return;
+    }
+    TouchClient(*client);
+    EndSubscription(*client);
+}
+
+void Server::ProcessStreamReport(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<StreamReportHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    const StreamReportHeader header = WireCodec<StreamReportHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(header.client_id, client_addr);
+    if (client == nullptr) {
+        return;
+    }
+    TouchClient(*client);
+    logger_.Log("Subscriber " + std::to_string(client->id) + " missed " + std::to_string(header.missed) + " of "
+                + std::to_string(header.highest_sequence + 1) + " datagrams, "
+                + std::to_string(client->stream_sequence) + " sent");
+}
+
+// Sends the values a subscription owes by now and schedules its next tick.
+// Values come from the counter-based stream, so between ticks a subscriber
+// costs a few fields and a timer, and a tick a single pass that writes the
+// datagrams in place
+void Server::StreamTick(Client& client) {
+    if (client.subscription_rate == 0) {
+        return;
+    }
+    const uint64_t rate = client.subscription_rate;
+    constexpr uint32_t HEADERS_SIZE = PROTOCOL_HEADER_SIZE + WireCodec<StreamDataHeader>::SIZE;
+    const uint32_t per_datagram = (client.packet_data_size - WireCodec<StreamDataHeader>::SIZE) / sizeof(double);
+    const uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimerWheel::Clock::now()
+                                                                                    - client.stream_started).count();
+    const uint64_t due = rate * (elapsed / 1000000) + rate * (elapsed % 1000000) / 1000000;
+    const uint64_t max_burst = static_cast<uint64_t>(STREAM_MAX_BURST) * per_datagram;
+    if (due - client.stream_values > max_burst) {
+        // Behind schedule: what is overdue is skipped rather than sent in a
+        // burst, and the client sees it as a sequence gap
+        const uint64_t skipped = (due - client.stream_values - max_burst + per_datagram - 1) / per_datagram;
+        client.stream_sequence += skipped;
+        client.stream_values += skipped * per_datagram;
+        logger_.Log("Subscriber " + std::to_string(client.id) + " behind, skipped " + std::to_string(skipped) + " datagrams");
+    }
+
+    const uint64_t owed = due > client.stream_values ? due - client.stream_values : 0;
+    if (owed > 0) {
+        // Headers and values are whole doubles, so every datagram's values
+        // stay aligned for the generator
+        const uint32_t datagrams = (owed + per_datagram - 1) / per_datagram;
+        const uint32_t datagram_size = HEADERS_SIZE + per_datagram * sizeof(double);
+        std::vector<double> out(static_cast<size_t>(datagrams) * datagram_size / sizeof(double));
+        char* base = reinterpret_cast<char*>(out.data());
+        size_t size = 0;
+        for (uint32_t i = 0; i < datagrams; ++i) {
+            const uint32_t values = std::min<uint64_t>(per_datagram, owed - static_cast<uint64_t>(i) * per_datagram);
+            char* datagram = base + static_cast<size_t>(i) * datagram_size;
+            ProtocolHeader header;
+            header.packet_number = 1;
+            header.packets_total = 1;
+            header.data_size = WireCodec<StreamDataHeader>::SIZE + values * sizeof(double);
+            header.type = MessageType::STREAM_DATA;
+            header.encoding = FragmentEncoding::RAW;
+            WireCodec<ProtocolHeader>::Encode(header, datagram);
+            WireCodec<StreamDataHeader>::Encode(StreamDataHeader{client.stream_sequence++, values}, datagram + PROTOCOL_HEADER_SIZE);
+            Random::FillCounter(reinterpret_cast<double*>(datagram + HEADERS_SIZE), values, client.stream_seed, client.stream_values,
+                                0, client.stream_min, client.stream_max - client.stream_min);
+            client.stream_values += values;
+            size = static_cast<size_t>(i) * datagram_size + HEADERS_SIZE + values * sizeof(double);
+        }
+        ToSend to_send;
+        to_send.type = MessageType::STREAM_DATA;
+        to_send.client_addr = client.client_addr;
+        to_send.data = Buffer::Adopt(std::move(out)).Slice(0, size);
+        to_send.datagram_size = datagram_size;
+        stream_sends_.emplace_back(std::move(to_send));
+    }
+
+    // Slow subscriptions wait until a datagram is about full
+    const uint64_t fill_ms = per_datagram * 1000 / rate;
+    const uint64_t interval = std::min<uint64_t>(std::max<uint64_t>(fill_ms, STREAM_TICK_MS), STREAM_MAX_TICK_MS);
+    client.stream_timer = timers_.Schedule(std::chrono::milliseconds(interval), static_cast<uint8_t>(TimerKind::STREAM_TICK),
+                                           client.id);
+}
+
+void Server::EndSubscription(Client& client) {
+    timers_.Cancel(client.stream_timer);
+    client.subscription_rate = 0;
+}
+
+Buffer Server::NarrowDataset(const Dataset& dataset, const double* values) {
+    // Narrowing needs the ascending order; a descending dataset is mirrored
+    // afterwards, like the full-precision paths
+    std::vector<uint32_t> items(dataset.count);
+    Precision::Narrow(dataset.precision, values, 0, dataset.count, dataset.count, dataset.min, dataset.max, items.data());
+    if (dataset.descending) {
+        std::reverse(items.begin(), items.end());
+    }
+    return Buffer::Adopt(std::move(items));
+}
+
+bool Server::ValueRange(const double& value, double& min, double& max) {
+    // A request for v asks for values in [-|v|, |v|)
+    if (!(std::fabs(value) > 0)) {
+        return false;
+    }
+    min = -std::fabs(value);
+    max = std::fabs(value);
+    return true;
+}
+
+void Server::ProcessQuery(const struct sockaddr_in& client_addr, char* buffer, const uint32_t& buffer_size) {
+    logger_.Log(__func__);
+    if (buffer_size < PROTOCOL_HEADER_SIZE + WireCodec<QueryHeader>::SIZE) {
+        SendError(client_addr, ErrorCode::INVALID_HEADER);
+        return;
+    }
+    const QueryHeader q_header = WireCodec<QueryHeader>::Decode(buffer + PROTOCOL_HEADER_SIZE);
+    EpochGuard guard(client_handler_.GetEpoch());
+    Client* client = client_handler_.GetClient(q_header.client_id, client_addr);
+    if (client == nullptr) {
+        SendError(client_addr, ErrorCode::INVALID_SESSION);
+        return;
+    }
+    TouchClient(*client);
+
+    // The whole answer has to fit into one datagram of the session
+    const uint32_t max_items = (client->packet_data_size - WireCodec<QueryResultHeader>::SIZE) / sizeof(double);
+    const uint32_t parameter = q_header.parameter;
+    const QueryKind kind = q_header.kind;
+    double min = 0;
+    double max = 0;
+    bool valid_parameter = kind == QueryKind::SUMMARY
+                        || ((kind == QueryKind::TOP_K || kind == QueryKind::HISTOGRAM) && parameter > 0 && parameter <= max_items)
+                        || (kind == QueryKind::QUANTILES && parameter > 0 && parameter < max_items);
+    if (!valid_parameter || !ValueRange(q_header.value, min, max)) {
+        SendError(client_addr, ErrorCode::INVALID_VALUE, BundleSize(*client));
+        return;
+    }
+
+    // Same source as a REQUEST: a pooled dataset if one is ready, borrowed
+    // since queries only read it. Both are ascending, which the reductions
+    // rely on
+    const uint32_t count = protocol_conf_.values_amount;
+    DatasetPool::Entry pooled;
+    Buffer data;
+    if (pool_.Borrow(max, pooled)) {
+        data = pooled.data;
+    } else {
+        std::vector<double> values;
+        if (!generator_.GenerateUnique(values, count, min, max)) {
+            SendError(client_addr, ErrorCode::INVALID_VALUE, BundleSize(*client));
+            return;
+        }
+        data = Buffer::Adopt(std::move(values));
+    }
+    const double* values = data.As<double>();
+    const size_t size = data.Size() / sizeof(double);
+
+    QueryResultHeader r_header;
+    r_header.kind = kind;
+    constexpr size_t RESULT_HEADER_SIZE = WireCodec<QueryResultHeader>::SIZE;
+    std::vector<char> payload(RESULT_HEADER_SIZE);
+    switch (kind) {
+        case QueryKind::SUMMARY: {
+            SummaryResult summary;
+            summary.count = size;
+            summary.sum = Query::Sum(values, size);
+            summary.mean = size > 0 ? summary.sum / size : 0;
+            summary.min = size > 0 ? values[0] : 0;
+            summary.max = size > 0 ? values[size - 1] : 0;
+            r_header.items = 1;
+            payload.resize(RESULT_HEADER_SIZE + WireCodec<SummaryResult>::SIZE);
+            WireCodec<SummaryResult>::Encode(summary, payload.data() + RESULT_HEADER_SIZE);
+            break;
+        }
+        case QueryKind::TOP_K:
+        case QueryKind::QUANTILES: {
+            std::vector<double> result;
+            if (kind == QueryKind::TOP_K) {
+                Query::TopK(values, size, parameter, result);
+            } else {
+                Query::Quantiles(values, size, parameter, result);
+            }
+            r_header.items = result.size();
+            payload.resize(RESULT_HEADER_SIZE + result.size() * sizeof(double));
+            Wire::StoreArray(payload.data() + RESULT_HEADER_SIZE, result.data(), result.size());
+            break;
+        }
+        case QueryKind::HISTOGRAM: {
+            std::vector<uint32_t> bins;
+            Query::Histogram(values, size, min, max, parameter, bins);
+            r_header.items = bins.size();
+            payload.resize(RESULT_HEADER_SIZE + bins.size() * sizeof(uint32_t));
+            Wire::StoreArray(payload.data() + RESULT_HEADER_SIZE, bins.data(), bins.size());
+            break;
+        }
+        default: {
+            SendError(client_addr, ErrorCode::INVALID_VALUE, BundleSize(*client));
+            return;
+        }
+    }
+    WireCodec<QueryResultHeader>::Encode(r_header, payload.data());
+
+    ToSend to_send;
+    to_send.type = MessageType::QUERY_RESULT;
+    to_send.client_addr = client_addr;
+    to_send.data = Buffer::Adopt(std::move(payload));
+    to_send.packet_data_size = client->packet_data_size;
+    to_send.bundle_size = BundleSize(*client);
+    QueueReply(std::move(to_send));
 }
 
 Server::~Server() {
@@ -429,4 +1749,4 @@ Server::~Server() {
     #else
     close(sockfd);
     #endif
-}
+}
\ No newline at end of file
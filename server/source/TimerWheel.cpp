@@ -0,0 +1,162 @@
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel(const std::chrono::milliseconds& tick)
+    : tick_(std::chrono::duration_cast<Clock::duration>(tick))
+    , start_(Clock::now())
+    , now_tick_(0)
+    , size_(0) {
+    for (auto& slot : slots_) {
+        slot = NIL;
+    }
+}
+
+uint64_t TimerWheel::TickOf(const Clock::time_point& time) const {
+    if (time <= start_) {
+        return 0;
+    }
+    return (time - start_) / tick_;
+}
+
+TimerId TimerWheel::Schedule(const std::chrono::milliseconds& delay, const uint8_t& kind, const uint64_t& context) {
+    uint32_t index;
+    if (!free_nodes_.empty()) {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        index = nodes_.size();
+        nodes_.push_back(Node{0, 0, NIL, NIL, 1, NIL, 0});
+    }
+
+    // Round up so a timer never fires before its delay has passed
+    uint64_t ticks = (std::chrono::duration_cast<Clock::duration>(delay) + tick_ - Clock::duration(1)) / tick_;
+    Node& node = nodes_[index];
+    node.expires = now_tick_ + std::max<uint64_t>(ticks, 1);
+    node.context = context;
+    node.kind = kind;
+    Link(index);
+    ++size_;
+
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::Cancel(TimerId& timer_id) {
+    if (timer_id == INVALID_TIMER_ID) {
+        return false;
+    }
+    uint32_t index = static_cast<uint32_t>(timer_id);
+    uint32_t generation = static_cast<uint32_t>(timer_id >> 32);
+    timer_id = INVALID_TIMER_ID;
+    if (index >= nodes_.size() || nodes_[index].generation != generation || nodes_[index].slot == NIL) {
+        return false;
+    }
+    Unlink(index);
+    Release(index);
+    return true;
+}
+
+void TimerWheel::Link(const uint32_t& index) {
+    Node& node = nodes_[index];
+    uint64_t delta = node.expires > now_tick_ ? node.expires - now_tick_ : 1;
+    uint32_t level = 0;
+    while (level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    if (delta >= (1ULL << (SLOT_BITS * LEVELS))) {
+        // Delays past the wheel horizon (~49 days at 1 ms) are clamped to it
+        node.expires = now_tick_ + (1ULL << (SLOT_BITS * LEVELS)) - 1;
+    }
+
+    uint32_t slot = level * SLOTS + ((node.expires >> (SLOT_BITS * level)) & SLOT_MASK);
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = slots_[slot];
+    if (node.next != NIL) {
+        nodes_[node.next].prev = index;
+    }
+    slots_[slot] = index;
+}
+
+void TimerWheel::Unlink(const uint32_t& index) {
+    Node& node = nodes_[index];
+    if (node.prev != NIL) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        slots_[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.slot = NIL;
+}
+
+void TimerWheel::Release(const uint32_t& index) {
+    // Bumping the generation invalidates every TimerId handed out for this node
+    ++nodes_[index].generation;
+    if (nodes_[index].generation == 0) {
+        nodes_[index].generation = 1;
+    }
+    free_nodes_.push_back(index);
+    --size_;
+}
+
+void TimerWheel::Cascade(const uint32_t& level) {
+    uint32_t slot = level * SLOTS + ((now_tick_ >> (SLOT_BITS * level)) & SLOT_MASK);
+    uint32_t index = slots_[slot];
+    slots_[slot] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes_[index].next;
+        Link(index);
+        index = next;
+    }
+}
+
+void TimerWheel::Advance(const Clock::time_point& now, const Handler& handler) {
+    uint64_t target = TickOf(now);
+    while (now_tick_ < target) {
+        if (size_ == 0) {
+            now_tick_ = target;
+            break;
+        }
+        ++now_tick_;
+
+        // Crossing a level boundary pulls the next block of timers down
+        for (uint32_t level = 1; level < LEVELS; ++level) {
+            if (((now_tick_ >> (SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+                break;
+            }
+            Cascade(level);
+        }
+
+        // Handlers may schedule or cancel timers, so pop one node at a time
+        uint32_t slot = now_tick_ & SLOT_MASK;
+        while (slots_[slot] != NIL) {
+            uint32_t index = slots_[slot];
+            uint8_t kind = nodes_[index].kind;
+            uint64_t context = nodes_[index].context;
+            Unlink(index);
+            Release(index);
+            handler(kind, context);
+        }
+    }
+}
+
+TimerWheel::Clock::time_point TimerWheel::NextExpiry() const {
+    // Look for the next busy slot on the lowest level; past the end of the
+    // current block the next cascade is due anyway
+    uint64_t tick = now_tick_ + 1;
+    while (true) {
+        if (slots_[tick & SLOT_MASK] != NIL || (tick & SLOT_MASK) == 0) {
+            break;
+        }
+        ++tick;
+    }
+    return start_ + tick * tick_;
+}
+
+bool TimerWheel::Empty() const {
+    return size_ == 0;
+}
+
+size_t TimerWheel::Size() const {
+    return size_;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "Bundle.hpp"
+#include "Check.hpp"
+
+#include <vector>
+
+namespace {
+// Appends a message with its own header, as a peer could, bypassing the
+// checks of BundleWriter
+void AppendRaw(std::vector<char>& datagram, const MessageType& type, const std::vector<char>& payload) {
+    const size_t offset = datagram.size();
+    datagram.resize(offset + PROTOCOL_HEADER_SIZE + payload.size());
+    WireCodec<ProtocolHeader>::Encode(BundleWriter::Header(type, payload.size()), datagram.data() + offset);
+    std::copy(payload.begin(), payload.end(), datagram.begin() + offset + PROTOCOL_HEADER_SIZE);
+}
+
+std::vector<char> Bundle(const std::vector<MessageType>& types) {
+    std::vector<char> datagram(PROTOCOL_HEADER_SIZE);
+    for (const MessageType& type : types) {
+        AppendRaw(datagram, type, std::vector<char>(6, 'x'));
+    }
+    WireCodec<ProtocolHeader>::Encode(BundleWriter::Header(MessageType::BUNDLE, datagram.size() - PROTOCOL_HEADER_SIZE),
+                                      datagram.data());
+    return datagram;
+}
+
+// Messages the reader hands out before it stops
+size_t Count(const std::vector<char>& datagram, bool& malformed) {
+    BundleReader reader(datagram.data(), datagram.size());
+    size_t offset = 0;
+    size_t size = 0;
+    size_t count = 0;
+    while (reader.Next(offset, size)) {
+        ++count;
+    }
+    malformed = reader.Malformed();
+    return count;
+}
+
+void TestWriterReader() {
+    char datagram[DEFAULT_PACKET_SIZE];
+    BundleWriter writer(datagram, sizeof(datagram));
+    const char payload[] = "abcdef";
+    CHECK(writer.Append(MessageType::ACKNOWLEDGE, payload, 6));
+    CHECK(writer.Append(MessageType::ERROR_CODE, payload, 3));
+    CHECK(!writer.Append(MessageType::RESPONSE, payload, 6));
+    CHECK(!writer.Append(MessageType::BUNDLE, payload, 6));
+    CHECK(!writer.Append(MessageType::ACKNOWLEDGE, payload, sizeof(datagram)));
+    const size_t size = writer.Finish();
+    CHECK(size == 3 * PROTOCOL_HEADER_SIZE + 9);
+
+    BundleReader reader(datagram, size);
+    size_t offset = 0;
+    size_t message_size = 0;
+    CHECK(reader.Next(offset, message_size));
+    CHECK(offset == PROTOCOL_HEADER_SIZE && message_size == PROTOCOL_HEADER_SIZE + 6);
+    CHECK(WireView<ProtocolHeader>(datagram + offset).Get<&ProtocolHeader::type>() == MessageType::ACKNOWLEDGE);
+    CHECK(reader.Next(offset, message_size));
+    CHECK(message_size == PROTOCOL_HEADER_SIZE + 3);
+    CHECK(!reader.Next(offset, message_size));
+    CHECK(!reader.Malformed());
+}
+
+void TestRejected() {
+    bool malformed = false;
+    CHECK(Count(Bundle({MessageType::CONNECT, MessageType::REQUEST}), malformed) == 2);
+    CHECK(!malformed);
+    // Nested bundles and RESPONSE fragments stop the reader where they are
+    CHECK(Count(Bundle({MessageType::CONNECT, MessageType::BUNDLE, MessageType::REQUEST}), malformed) == 1);
+    CHECK(malformed);
+    CHECK(Count(Bundle({MessageType::RESPONSE, MessageType::REQUEST}), malformed) == 0);
+    CHECK(malformed);
+    // A message running past the end of the datagram
+    std::vector<char> truncated = Bundle({MessageType::CONNECT, MessageType::REQUEST});
+    truncated.pop_back();
+    CHECK(Count(truncated, malformed) == 1);
+    CHECK(malformed);
+    std::vector<char> short_header(PROTOCOL_HEADER_SIZE - 1);
+    CHECK(Count(short_header, malformed) == 0);
+    CHECK(malformed);
+}
+}
+
+int main() {
+    TestWriterReader();
+    TestRejected();
+    return CheckResult();
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+
+// Assertions for the test executables. A failed CHECK is reported and
+// counted instead of aborting, so one run shows every failure; main returns
+// CheckResult(), which is non-zero once anything failed.
+inline int& CheckFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n";    \
+            ++CheckFailures();                                                                 \
+        }                                                                                      \
+    } while (false)
+
+inline int CheckResult() {
+    if (CheckFailures() != 0) {
+        std::cerr << CheckFailures() << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
+
+#endif // CHECK_HPP
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "ClientHandler.hpp"
+#include "Check.hpp"
+
+#include <vector>
+
+namespace {
+struct sockaddr_in Address(const uint32_t& host, const uint16_t& port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(0x0A000000 | host);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+void TestAddressMismatch() {
+    ClientHandler handler(16);
+    const struct sockaddr_in owner = Address(1, 5000);
+    const uint32_t id = handler.AddClient(owner);
+    CHECK(id != INVALID_CLIENT_ID);
+
+    EpochGuard guard(handler.GetEpoch());
+    CHECK(handler.GetClient(id, owner) == handler.GetClient(id));
+    CHECK(handler.GetClient(id, owner) != nullptr);
+    // Same host on another port, another host on the same port
+    CHECK(handler.GetClient(id, Address(1, 5001)) == nullptr);
+    CHECK(handler.GetClient(id, Address(2, 5000)) == nullptr);
+    CHECK(handler.GetClient(id + 1, owner) == nullptr);
+    CHECK(handler.GetClient(INVALID_CLIENT_ID, owner) == nullptr);
+    CHECK(!handler.RemoveClient(id, Address(2, 5000)));
+    CHECK(handler.Size() == 1);
+    CHECK(handler.RemoveClient(id, owner));
+    CHECK(handler.GetClient(id, owner) == nullptr);
+    CHECK(!handler.RemoveClient(id, owner));
+}
+
+void TestTombstoneRebuild() {
+    // 64 sessions use a 128-slot table, which is rebuilt once more than 32
+    // slots are tombstones
+    constexpr uint32_t MAX_CLIENTS = 64;
+    ClientHandler handler(MAX_CLIENTS);
+    std::vector<uint32_t> ids(MAX_CLIENTS);
+    for (uint32_t i = 0; i < MAX_CLIENTS; ++i) {
+        ids[i] = handler.AddClient(Address(i, 6000 + i));
+        CHECK(ids[i] != INVALID_CLIENT_ID);
+    }
+    CHECK(handler.AddClient(Address(999, 1)) == INVALID_CLIENT_ID);
+
+    for (uint32_t i = 0; i < 40; ++i) {
+        CHECK(handler.RemoveClient(ids[i], Address(i, 6000 + i)));
+    }
+    CHECK(handler.Size() == MAX_CLIENTS - 40);
+    {
+        EpochGuard guard(handler.GetEpoch());
+        for (uint32_t i = 0; i < MAX_CLIENTS; ++i) {
+            Client* client = handler.GetClient(ids[i], Address(i, 6000 + i));
+            CHECK((client != nullptr) == (i >= 40));
+        }
+    }
+
+    // Churn far past the table size: tombstones are reused or rebuilt away,
+    // and every live session stays reachable throughout
+    for (uint32_t round = 0; round < 10000; ++round) {
+        const uint32_t host = 1000 + round;
+        handler.GetEpoch().Collect();
+        const uint32_t id = handler.AddClient(Address(host, 7000));
+        CHECK(id != INVALID_CLIENT_ID);
+        {
+            EpochGuard guard(handler.GetEpoch());
+            CHECK(handler.GetClient(id, Address(host, 7000)) != nullptr);
+            CHECK(handler.GetClient(ids[63], Address(63, 6063)) != nullptr);
+        }
+        CHECK(handler.RemoveClient(id, Address(host, 7000)));
+    }
+    CHECK(handler.Size() == MAX_CLIENTS - 40);
+    EpochGuard guard(handler.GetEpoch());
+    for (uint32_t i = 40; i < MAX_CLIENTS; ++i) {
+        CHECK(handler.GetClient(ids[i], Address(i, 6000 + i)) != nullptr);
+    }
+}
+}
+
+int main() {
+    TestAddressMismatch();
+    TestTombstoneRebuild();
+    return CheckResult();
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "Crc32c.hpp"
+#include "Check.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+// Check values from RFC 3720, B.4, and the usual "123456789"
+void TestKnownVectors() {
+    std::vector<uint8_t> data(32, 0x00);
+    CHECK(Crc32c::Compute(data.data(), data.size()) == 0x8A9136AA);
+    CHECK(Crc32c::ExtendPortable(0, data.data(), data.size()) == 0x8A9136AA);
+    data.assign(32, 0xFF);
+    CHECK(Crc32c::Compute(data.data(), data.size()) == 0x62A8AB43);
+    CHECK(Crc32c::ExtendPortable(0, data.data(), data.size()) == 0x62A8AB43);
+    for (uint32_t i = 0; i < 32; ++i) {
+        data[i] = i;
+    }
+    CHECK(Crc32c::Compute(data.data(), data.size()) == 0x46DD794E);
+    CHECK(Crc32c::ExtendPortable(0, data.data(), data.size()) == 0x46DD794E);
+    const char* digits = "123456789";
+    CHECK(Crc32c::Compute(digits, strlen(digits)) == 0xE3069283);
+    CHECK(Crc32c::ExtendPortable(0, digits, strlen(digits)) == 0xE3069283);
+    CHECK(Crc32c::Compute(digits, 0) == 0);
+}
+
+// The selected kernel, e.g. SSE4.2 with its three-lane merge, against the
+// slicing-by-8 tables: every length around the lane thresholds, at every
+// alignment, and split into chunks
+void TestKernelsAgree() {
+    std::mt19937 random(1);
+    std::vector<uint8_t> data(8 * Crc32c::LANE_SIZE + 64);
+    for (uint8_t& byte : data) {
+        byte = random();
+    }
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 64; ++size) {
+        sizes.push_back(size);
+    }
+    for (size_t lanes = 1; lanes <= 7; ++lanes) {
+        for (size_t delta = 0; delta < 16; ++delta) {
+            sizes.push_back(lanes * Crc32c::LANE_SIZE - 8 + delta);
+        }
+    }
+    for (const size_t& size : sizes) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            const uint32_t expected = Crc32c::ExtendPortable(0, data.data() + offset, size);
+            CHECK(Crc32c::Compute(data.data() + offset, size) == expected);
+            const size_t split = size / 3;
+            CHECK(Crc32c::Extend(Crc32c::Compute(data.data() + offset, split), data.data() + offset + split, size - split) == expected);
+        }
+    }
+}
+}
+
+int main() {
+    TestKnownVectors();
+    TestKernelsAgree();
+    return CheckResult();
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "FragmentCodec.hpp"
+#include "Generator.hpp"
+#include "Check.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr uint32_t FRAGMENT_VALUES = (DEFAULT_PACKET_SIZE - PROTOCOL_HEADER_SIZE) / sizeof(double);
+
+// Encodes and decodes `count` values, checks they come back bit for bit and
+// returns the encoding used
+FragmentEncoding RoundTrip(const double* values, const uint32_t& count) {
+    std::vector<char> encoded(count * sizeof(double));
+    FragmentEncoding encoding;
+    const uint32_t size = FragmentCodec::Encode(values, count, encoded.data(), encoding);
+    CHECK(size <= count * sizeof(double));
+    std::vector<double> decoded(count);
+    CHECK(FragmentCodec::Decode(encoding, encoded.data(), size, decoded.data(), count, 1.0) == count);
+    CHECK(memcmp(decoded.data(), values, count * sizeof(double)) == 0);
+    return encoding;
+}
+
+void TestResponseFragments() {
+    // A response for 1e9 split into fragments, ascending and descending.
+    // Only the fragment that crosses zero has deltas too wide to pack
+    Generator generator(1);
+    std::vector<double> values;
+    CHECK(generator.GenerateStateless(values, 1000000, -1e9, 1e9, 5));
+    for (const bool& descending : {false, true}) {
+        if (descending) {
+            std::reverse(values.begin(), values.end());
+        }
+        uint32_t raw = 0;
+        for (uint32_t first = 0; first < values.size(); first += FRAGMENT_VALUES) {
+            const uint32_t count = std::min<uint32_t>(FRAGMENT_VALUES, values.size() - first);
+            const bool crosses_zero = (values[first] < 0) != (values[first + count - 1] < 0);
+            const FragmentEncoding encoding = RoundTrip(values.data() + first, count);
+            CHECK((encoding == FragmentEncoding::RAW) == crosses_zero);
+            raw += encoding == FragmentEncoding::RAW;
+        }
+        CHECK(raw == 1);
+    }
+}
+
+void TestRawFallbacks() {
+    // Not monotone
+    const double unordered[] = {1.0, 3.0, 2.0, 4.0};
+    CHECK(RoundTrip(unordered, 4) == FragmentEncoding::RAW);
+    // Too short to gain anything
+    const double single[] = {42.0};
+    CHECK(RoundTrip(single, 1) == FragmentEncoding::RAW);
+    const double pair[] = {-1e300, 1e300};
+    CHECK(RoundTrip(pair, 2) == FragmentEncoding::RAW);
+    // Crossing zero, with negative and positive zero
+    const double signs[] = {-2.5, -1e-300, -0.0, 0.0, 1e-300, 2.5};
+    CHECK(RoundTrip(signs, 6) == FragmentEncoding::RAW);
+    // Repeated values pack at width 0
+    std::vector<double> constant(100, 7.25);
+    CHECK(RoundTrip(constant.data(), constant.size()) == FragmentEncoding::DELTA);
+}
+
+void TestMalformed() {
+    std::vector<double> values(FRAGMENT_VALUES);
+    for (uint32_t i = 0; i < values.size(); ++i) {
+        values[i] = 1000.0 + i;
+    }
+    std::vector<char> encoded(values.size() * sizeof(double));
+    FragmentEncoding encoding;
+    const uint32_t size = FragmentCodec::Encode(values.data(), values.size(), encoded.data(), encoding);
+    CHECK(encoding == FragmentEncoding::DELTA);
+    std::vector<double> decoded(values.size());
+    // Truncated, and more values than the caller has room for
+    CHECK(FragmentCodec::Decode(encoding, encoded.data(), size - 1, decoded.data(), decoded.size(), 1.0) == 0);
+    CHECK(FragmentCodec::Decode(encoding, encoded.data(), 4, decoded.data(), decoded.size(), 1.0) == 0);
+    CHECK(FragmentCodec::Decode(encoding, encoded.data(), size, decoded.data(), decoded.size() - 1, 1.0) == 0);
+    // RAW payloads must hold whole doubles
+    CHECK(FragmentCodec::Decode(FragmentEncoding::RAW, encoded.data(), 12, decoded.data(), decoded.size(), 1.0) == 0);
+}
+}
+
+int main() {
+    TestResponseFragments();
+    TestRawFallbacks();
+    TestMalformed();
+    return CheckResult();
+}
\ No newline at end of file
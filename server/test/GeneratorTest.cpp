@@ -0,0 +1,106 @@
+#include "Generator.hpp"
+#include "Check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+bool StrictlyAscending(const std::vector<double>& values) {
+    for (size_t i = 1; i < values.size(); ++i) {
+        if (!(values[i - 1] < values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WithinRange(const std::vector<double>& values, const double& min, const double& max) {
+    return values.empty() || (values.front() >= min && values.back() < max);
+}
+
+void TestStratified() {
+    Generator generator(1);
+    // Below and above PARALLEL_THRESHOLD, and a count that ends mid-block
+    const uint32_t counts[] = {1, 1000, Generator::BLOCK_SIZE + 17, Generator::PARALLEL_THRESHOLD + 12345};
+    for (const uint32_t& count : counts) {
+        std::vector<double> values;
+        CHECK(Generator::Stratifiable(count, -1e9, 1e9));
+        CHECK(generator.GenerateUnique(values, count, -1e9, 1e9, 42));
+        CHECK(values.size() == count);
+        CHECK(StrictlyAscending(values));
+        CHECK(WithinRange(values, -1e9, 1e9));
+
+        std::vector<double> again;
+        CHECK(generator.GenerateUnique(again, count, -1e9, 1e9, 42));
+        CHECK(again == values);
+    }
+    // Strata close to the double spacing still come out distinct
+    std::vector<double> values;
+    const double min = 1.0;
+    const double max = 1.0 + 3 * 1000 * std::ldexp(1.0, -52);
+    CHECK(Generator::Stratifiable(1000, min, max));
+    CHECK(generator.GenerateUnique(values, 1000, min, max, 7));
+    CHECK(values.size() == 1000);
+    CHECK(StrictlyAscending(values));
+    CHECK(WithinRange(values, min, max));
+}
+
+void TestSortDedupe() {
+    Generator generator(2);
+    // 1500 doubles for 1000 values: too narrow for strata, wide enough for
+    // the sort fallback
+    const double min = 1.0;
+    const double max = 1.0 + 1500 * std::ldexp(1.0, -52);
+    CHECK(!Generator::Stratifiable(1000, min, max));
+    std::vector<double> values;
+    CHECK(generator.GenerateUnique(values, 1000, min, max, 3));
+    CHECK(values.size() == 1000);
+    CHECK(StrictlyAscending(values));
+    CHECK(WithinRange(values, min, max));
+
+    // Fewer doubles than values cannot work
+    const double tight = 1.0 + 500 * std::ldexp(1.0, -52);
+    CHECK(!generator.GenerateUnique(values, 1000, min, tight, 3));
+    CHECK(!generator.GenerateUnique(values, 10, 1.0, 1.0, 3));
+}
+
+// Retransmits of stateless datasets rebuild fragments with Regenerate, so
+// any slice has to match what GenerateStateless produced bit for bit
+void TestRegenerate() {
+    Generator generator(3);
+    const uint32_t count = Generator::PARALLEL_THRESHOLD + 4321;
+    const double ranges[][2] = {{-1e9, 1e9}, {0.5, 0.75}, {1.0, 1.0 + 3.0 * count * std::ldexp(1.0, -52)}};
+    for (const auto& range : ranges) {
+        std::vector<double> values;
+        CHECK(generator.GenerateStateless(values, count, range[0], range[1], 99));
+        CHECK(values.size() == count);
+        CHECK(StrictlyAscending(values));
+        std::vector<double> descending(values.rbegin(), values.rend());
+
+        // Slices at the start, across block seams, of one value and at the end
+        const uint32_t slices[][2] = {{0, 255}, {Generator::BLOCK_SIZE - 100, 200}, {Generator::BLOCK_SIZE, 1},
+                                      {3 * Generator::BLOCK_SIZE + 7, 5000}, {count - 300, 300}, {0, count}};
+        for (const auto& slice : slices) {
+            const uint32_t first = slice[0];
+            const uint32_t size = slice[1];
+            std::vector<double> out(size);
+            Generator::Regenerate(out.data(), first, size, count, range[0], range[1], 99);
+            CHECK(memcmp(out.data(), values.data() + first, size * sizeof(double)) == 0);
+            Generator::RegenerateDescending(out.data(), first, size, count, range[0], range[1], 99);
+            CHECK(memcmp(out.data(), descending.data() + first, size * sizeof(double)) == 0);
+        }
+    }
+    // Too narrow for strata: no stateless layout
+    std::vector<double> values;
+    CHECK(!generator.GenerateStateless(values, 1000, 1.0, 1.0 + 1500 * std::ldexp(1.0, -52), 99));
+}
+}
+
+int main() {
+    TestStratified();
+    TestSortDedupe();
+    TestRegenerate();
+    return CheckResult();
+}
\ No newline at end of file